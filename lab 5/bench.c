@@ -0,0 +1,225 @@
+/*******************************************************************************
+ * Joseph Adams
+ *
+ * bench.c is a program for measuring the speed of the sudoku solvers. It
+ * takes the names of corpus files, each holding puzzles in the same format
+ * as the input of sudoku.c, and solves every puzzle of each file several
+ * times. For each file it prints one line of comma separated values giving
+ * the puzzles solved per second, the mean and tail latency of a puzzle and
+ * the search nodes used per puzzle, so runs can be compared by a script.
+ *
+ * Each corpus is first solved a few times without being measured, so the
+ * caches and the branch predictor have seen it, and then solved again for
+ * the measured repetitions. Every puzzle of every repetition is recorded in
+ * a Latency, so the percentiles cover all of them.
+ *
+ * The corpora used by "make bench" are in the bench directory:
+ * easy.txt         puzzles with many hints, solved by propagation alone
+ * seventeen.txt    puzzles with 17 hints, the fewest a unique puzzle can have
+ * hardest.txt      puzzles known to be hard for human and computer solvers
+ * invalid.txt      malformed lines and puzzles with no solution
+ *
+ * No two puzzles of a corpus are relabellings or reorderings of each other,
+ * so a solver or the cache of cache.c cannot get through one by having
+ * seen another. seventeen.txt holds the 32 such puzzles that could be
+ * reached from a handful of well-known ones by swapping hints. hardest.txt
+ * holds six well-known hard puzzles, followed by the 194 puzzles that were
+ * hardest for solve() among those a few swapped hints away from them.
+ *
+*******************************************************************************/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "solver.h"
+#include "stats.h"
+#include "io.h"
+#include "engine.h"
+
+struct Tally
+{
+  unsigned long results[RESULTS]; /* puzzles with each result */
+  struct Latency latency;         /* times and search counts */
+};
+
+struct Engine engine = {BACKTRACK, 0, 1, NULL};
+/*engine.kind is set by the -e option to solve with dlx.c or sat.c instead.*/
+int warmup = 2;
+/*warmup is the number of unmeasured passes over a corpus, set by -w.*/
+int repetitions = 5;
+/*repetitions is the number of measured passes over a corpus, set by -r.*/
+struct Worker worker;
+/*worker holds the solver state of every engine.*/
+
+/*******************************************************************************
+ * run_pass() solves every line of file once with solve_puzzle() from
+ * engine.c, so each puzzle goes through the same checks and the same
+ * engine as it would in sudoku.c. If tally is not NULL, the result, time
+ * and search counts of each puzzle are added to it.
+*******************************************************************************/
+
+void run_pass(struct MappedFile* file, struct Tally* tally)
+{
+  struct SearchStats none = {0, 0, 0, 0};
+  const char* line;
+  long number = 1;
+  int found;
+  int len;
+
+  file->pos = 0;
+  while ((line = next_line(file, &len)) != NULL)
+    {
+      unsigned long start = latency_now();
+      int result = solve_puzzle(&engine, &worker, line, len, NO, &found);
+      unsigned long ns = latency_now() - start;
+      if (tally != NULL)
+        {
+          const struct SearchStats* search = &none;
+          int timed_out;
+          if (result != ERROR)
+            {
+              search = engine_search(&engine, &worker, &timed_out);
+            }
+          tally->results[result]++;
+          latency_record(&tally->latency, number, ns, search);
+        }
+      number++;
+    }
+}
+
+/*******************************************************************************
+ * run_corpus() benchmarks the file called name and prints its line of
+ * results. puzzles_per_sec is worked out from the total time spent solving,
+ * not from the wall clock, so reading the file is not counted. Returns 0,
+ * or 1 if the file could not be read.
+*******************************************************************************/
+
+int run_corpus(const char* name)
+{
+  struct MappedFile file;
+  struct Tally* tally;
+  const struct Latency* latency;
+  const char* base = strrchr(name, '/');
+  double puzzles;
+  int k;
+
+  if (map_file(&file, name) < 0)
+    {
+      perror(name);
+      return 1;
+    }
+  tally = calloc(1, sizeof(struct Tally));
+  if (tally == NULL)
+    {
+      fprintf(stderr, "bench: out of memory\n");
+      exit(1);
+    }
+  for (k = 0; k < warmup; k++) run_pass(&file, NULL);
+  for (k = 0; k < repetitions; k++) run_pass(&file, tally);
+
+  latency = &tally->latency;
+  puzzles = latency->count ? latency->count : 1;
+  printf("%s,%s,%d,%lu,%d,%lu,%lu,%lu,%lu,%.0f,%.3f,%.3f,%.3f,%.3f,%.3f,"
+         "%.2f,%.2f\n", base ? base + 1 : name,
+         engine.kind == DLX ? "dlx" : engine.kind == SAT ? "sat" : "backtrack",
+         SIZE,
+         latency->count/(repetitions ? repetitions : 1), repetitions,
+         tally->results[SOLVED], tally->results[NO_SOLUTION],
+         tally->results[ERROR], tally->results[TIMEOUT],
+         latency->total_ns > 0 ? latency->count/(latency->total_ns/1e9) : 0,
+         latency->total_ns/puzzles/1e3,
+         latency_percentile(latency, 0.50)/1e3,
+         latency_percentile(latency, 0.90)/1e3,
+         latency_percentile(latency, 0.99)/1e3, latency->max_ns/1e3,
+         latency->search.nodes/puzzles, latency->search.backtracks/puzzles);
+  free(tally);
+  unmap_file(&file);
+  return 0;
+}
+
+/*******************************************************************************
+ * usage() prints the command line options and returns the exit status 1.
+*******************************************************************************/
+
+int usage(const char* name)
+{
+  fprintf(stderr, "usage: %s [-e backtrack|dlx|sat] [-w warmup] "
+          "[-r repetitions] [-n nodes] [-T ms] [-H] corpus...\n", name);
+  return 1;
+}
+
+/*******************************************************************************
+ * main() reads the same -e, -n and -T options as sudoku.c, along with "-w n"
+ * and "-r n" for the unmeasured and measured passes over each corpus. The
+ * header line naming the columns is printed first unless -H is given, so
+ * the output of several runs can be joined into one table.
+ *
+ * The columns are: corpus, engine, size, puzzles, reps, solved,
+ * no_solution, errors, timeouts, puzzles_per_sec, mean_us, p50_us, p90_us,
+ * p99_us, max_us, nodes_per_puzzle and backtracks_per_puzzle. The result
+ * counts are added up over all repetitions.
+*******************************************************************************/
+
+int main(int argc, char* argv[])
+{
+  unsigned long limit;
+  int header = YES;
+  int status = 0;
+  int arg;
+
+  for (arg = 1; arg < argc && argv[arg][0] == '-'; arg++)
+    {
+      if (strcmp(argv[arg], "-e") == 0 && arg + 1 < argc)
+        {
+          arg++;
+          if (strcmp(argv[arg], "dlx") == 0) engine.kind = DLX;
+          else if (strcmp(argv[arg], "sat") == 0) engine.kind = SAT;
+          else if (strcmp(argv[arg], "backtrack") == 0) engine.kind = BACKTRACK;
+          else return usage(argv[0]);
+        }
+      else if (strcmp(argv[arg], "-w") == 0 && arg + 1 < argc)
+        {
+          warmup = atoi(argv[++arg]);
+          if (warmup < 0) return usage(argv[0]);
+        }
+      else if (strcmp(argv[arg], "-r") == 0 && arg + 1 < argc)
+        {
+          repetitions = atoi(argv[++arg]);
+          if (repetitions < 1) return usage(argv[0]);
+        }
+      else if (strcmp(argv[arg], "-n") == 0 && arg + 1 < argc)
+        {
+          limit = strtoul(argv[++arg], NULL, 10);
+          worker.sudoku.node_limit = limit;
+          worker.dlx.node_limit = limit;
+          worker.sat.node_limit = limit;
+        }
+      else if (strcmp(argv[arg], "-T") == 0 && arg + 1 < argc)
+        {
+          limit = strtoul(argv[++arg], NULL, 10)*1000000UL;
+          worker.sudoku.time_limit = limit;
+          worker.dlx.time_limit = limit;
+          worker.sat.time_limit = limit;
+        }
+      else if (strcmp(argv[arg], "-H") == 0) header = NO;
+      else return usage(argv[0]);
+    }
+  if (arg == argc) return usage(argv[0]);
+
+  solver_init();
+  if (header)
+    {
+      printf("corpus,engine,size,puzzles,reps,solved,no_solution,errors,"
+             "timeouts,puzzles_per_sec,mean_us,p50_us,p90_us,p99_us,max_us,"
+             "nodes_per_puzzle,backtracks_per_puzzle\n");
+    }
+  for (; arg < argc; arg++)
+    {
+      status |= run_corpus(argv[arg]);
+      fflush(stdout);
+    }
+  sat_free(&worker.sat);
+  return status;
+}
@@ -0,0 +1,298 @@
+/*******************************************************************************
+ * Joseph Adams
+ *
+ * cache.c is a source file implementing the functions found in cache.h.
+ * These functions are used to keep the results of puzzles already solved,
+ * so a puzzle seen again, or any puzzle with the same canonical form, does
+ * not have to be solved again.
+ *
+ * The entries are kept in one array. A hash table of chains through the
+ * array finds the entry for a puzzle, and a doubly linked list through it
+ * keeps the entries in the order they were last used, so the least recently
+ * used one is always at the end of the list and can be reused at once.
+ *
+ * A saved cache is a text file. Its first line names the puzzle size and
+ * tag, and each other line holds one entry: the canonical puzzle, the
+ * result, the count and the solution, or '-' for none. Entries are written
+ * from least to most recently used, so loading them keeps that order.
+*******************************************************************************/
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cache.h"
+
+
+/*******************************************************************************
+ * hash() returns the FNV-1a hash of the CELLS characters of puzzle, reduced
+ * to a bucket of cache.
+*******************************************************************************/
+
+static int hash(const struct Cache* cache, const char* puzzle)
+{
+  unsigned long h = 2166136261UL;
+  int k;
+  for (k = 0; k < CELLS; k++)
+    {
+      h = ((h ^ (unsigned char)puzzle[k])*16777619UL) & 0xFFFFFFFFUL;
+    }
+  return h & (cache->bucket_count - 1);
+}
+
+int cache_init(struct Cache* cache, int capacity)
+{
+  int k;
+  memset(cache, 0, sizeof(struct Cache));
+  cache->bucket_count = 1;
+  while (cache->bucket_count < capacity) cache->bucket_count *= 2;
+  cache->entries = malloc(capacity*sizeof(struct CacheEntry));
+  cache->buckets = malloc(cache->bucket_count*sizeof(int));
+  if (cache->entries == NULL || cache->buckets == NULL)
+    {
+      cache_free(cache);
+      return NO;
+    }
+  for (k = 0; k < cache->bucket_count; k++) cache->buckets[k] = -1;
+  cache->capacity = capacity;
+  cache->newest = -1;
+  cache->oldest = -1;
+  pthread_mutex_init(&cache->lock, NULL);
+  return YES;
+}
+
+void cache_free(struct Cache* cache)
+{
+  if (cache->capacity > 0) pthread_mutex_destroy(&cache->lock);
+  free(cache->entries);
+  free(cache->buckets);
+  cache->entries = NULL;
+  cache->buckets = NULL;
+  cache->capacity = 0;
+}
+
+/*******************************************************************************
+ * unlink_entry() takes entry k out of the list of recently used entries,
+ * and push_newest() puts it back at the newest end.
+*******************************************************************************/
+
+static void unlink_entry(struct Cache* cache, int k)
+{
+  struct CacheEntry* entry = &cache->entries[k];
+  if (entry->newer >= 0) cache->entries[entry->newer].older = entry->older;
+  else cache->newest = entry->older;
+  if (entry->older >= 0) cache->entries[entry->older].newer = entry->newer;
+  else cache->oldest = entry->newer;
+}
+
+static void push_newest(struct Cache* cache, int k)
+{
+  struct CacheEntry* entry = &cache->entries[k];
+  entry->newer = -1;
+  entry->older = cache->newest;
+  if (cache->newest >= 0) cache->entries[cache->newest].newer = k;
+  cache->newest = k;
+  if (cache->oldest < 0) cache->oldest = k;
+}
+
+/*******************************************************************************
+ * find() returns the entry holding puzzle, or -1 if there is none. The
+ * caller must hold the lock.
+*******************************************************************************/
+
+static int find(const struct Cache* cache, const char* puzzle)
+{
+  int k = cache->buckets[hash(cache, puzzle)];
+  while (k >= 0 && memcmp(cache->entries[k].puzzle, puzzle, CELLS) != 0)
+    {
+      k = cache->entries[k].chain;
+    }
+  return k;
+}
+
+int cache_lookup(struct Cache* cache, const char* puzzle, int* result,
+                 int* found, char* solution)
+{
+  int k;
+  pthread_mutex_lock(&cache->lock);
+  k = find(cache, puzzle);
+  if (k < 0)
+    {
+      cache->misses++;
+      pthread_mutex_unlock(&cache->lock);
+      return NO;
+    }
+  cache->hits++;
+  unlink_entry(cache, k);
+  push_newest(cache, k);
+  *result = cache->entries[k].result;
+  *found = cache->entries[k].found;
+  memcpy(solution, cache->entries[k].solution, CELLS);
+  pthread_mutex_unlock(&cache->lock);
+  return YES;
+}
+
+/*******************************************************************************
+ * cache_insert() takes a free entry, or when there is none removes the
+ * oldest entry from its hash chain and the list and reuses it. A puzzle
+ * that is already in the cache, because another thread solved it at the
+ * same time, is only marked as used.
+*******************************************************************************/
+
+void cache_insert(struct Cache* cache, const char* puzzle, int result,
+                  int found, const char* solution)
+{
+  struct CacheEntry* entry;
+  int bucket = hash(cache, puzzle);
+  int fresh = YES;
+  int k;
+
+  pthread_mutex_lock(&cache->lock);
+  k = find(cache, puzzle);
+  if (k >= 0)
+    {
+      unlink_entry(cache, k);
+      fresh = NO;
+    }
+  else if (cache->used < cache->capacity) k = cache->used++;
+  else
+    {
+      int* link;
+      k = cache->oldest;
+      unlink_entry(cache, k);
+      link = &cache->buckets[hash(cache, cache->entries[k].puzzle)];
+      while (*link != k) link = &cache->entries[*link].chain;
+      *link = cache->entries[k].chain;
+    }
+  entry = &cache->entries[k];
+  if (fresh)
+    {
+      memcpy(entry->puzzle, puzzle, CELLS);
+      entry->chain = cache->buckets[bucket];
+      cache->buckets[bucket] = k;
+    }
+  entry->result = result;
+  entry->found = found;
+  if (solution != NULL) memcpy(entry->solution, solution, CELLS);
+  else memset(entry->solution, '.', CELLS);
+  push_newest(cache, k);
+  pthread_mutex_unlock(&cache->lock);
+}
+
+/*******************************************************************************
+ * valid() returns YES if the len characters of text are all from DIGITS,
+ * or also '.' if blanks is set.
+*******************************************************************************/
+
+static int valid(const char* text, int len, int blanks)
+{
+  int k;
+  for (k = 0; k < len; k++)
+    {
+      if (digit_value[(unsigned char)text[k]] < 0 &&
+          !(blanks && text[k] == '.')) return NO;
+    }
+  return YES;
+}
+
+/*******************************************************************************
+ * solves() returns YES if solution, whose characters are all from DIGITS,
+ * is a complete grid with no digit twice in a row, column or block, and has
+ * every hint of puzzle in its place.
+*******************************************************************************/
+
+static int solves(const char* puzzle, const char* solution)
+{
+  mask_t row[SIZE];
+  mask_t col[SIZE];
+  mask_t box[SIZE];
+  int k;
+  memset(row, 0, sizeof(row));
+  memset(col, 0, sizeof(col));
+  memset(box, 0, sizeof(box));
+  for (k = 0; k < CELLS; k++)
+    {
+      mask_t bit = (mask_t)1 << digit_value[(unsigned char)solution[k]];
+      int r = k/SIZE;
+      int c = k%SIZE;
+      int b = (r/BOX)*BOX + c/BOX;
+      if (puzzle[k] != '.' && puzzle[k] != solution[k]) return NO;
+      if ((row[r] | col[c] | box[b]) & bit) return NO;
+      row[r] |= bit;
+      col[c] |= bit;
+      box[b] |= bit;
+    }
+  return YES;
+}
+
+/*******************************************************************************
+ * cache_load() reads the file one line at a time. A missing file is not an
+ * error, since the first run has nothing to load, and lines that do not
+ * hold an entry are skipped: a result out of range, a negative count, a
+ * solution that is not a legal grid or does not fit the puzzle, or a SOLVED
+ * result with no solution at all.
+*******************************************************************************/
+
+int cache_load(struct Cache* cache, const char* name, long tag)
+{
+  char line[2*CELLS + 64];
+  FILE* file = fopen(name, "r");
+  int size;
+  long file_tag;
+
+  if (file == NULL) return YES;
+  if (fgets(line, sizeof(line), file) == NULL ||
+      sscanf(line, "sudoku-cache %d %ld", &size, &file_tag) != 2 ||
+      size != SIZE || file_tag != tag)
+    {
+      fclose(file);
+      return YES;
+    }
+  while (fgets(line, sizeof(line), file) != NULL)
+    {
+      char* end;
+      char* solution;
+      int result;
+      int found;
+      if (strlen(line) < CELLS + 1 || line[CELLS] != ' ' ||
+          !valid(line, CELLS, YES)) continue;
+      result = strtol(line + CELLS, &end, 10);
+      found = strtol(end, &solution, 10);
+      if (end == line + CELLS || solution == end || *solution++ != ' ' ||
+          result < 0 || result >= RESULTS || found < 0)
+        {
+          continue;
+        }
+      if (strlen(solution) >= CELLS && valid(solution, CELLS, NO) &&
+          solves(line, solution))
+        {
+          cache_insert(cache, line, result, found, solution);
+        }
+      else if (*solution == '-' && result != SOLVED)
+        {
+          cache_insert(cache, line, result, found, NULL);
+        }
+    }
+  size = ferror(file);
+  fclose(file);
+  return size ? NO : YES;
+}
+
+int cache_save(struct Cache* cache, const char* name, long tag)
+{
+  FILE* file = fopen(name, "w");
+  int k;
+  if (file == NULL) return NO;
+  fprintf(file, "sudoku-cache %d %ld\n", SIZE, tag);
+  for (k = cache->oldest; k >= 0; k = cache->entries[k].newer)
+    {
+      const struct CacheEntry* entry = &cache->entries[k];
+      fwrite(entry->puzzle, 1, CELLS, file);
+      fprintf(file, " %d %d ", entry->result, entry->found);
+      if (entry->solution[0] == '.') fputc('-', file);
+      else fwrite(entry->solution, 1, CELLS, file);
+      fputc('\n', file);
+    }
+  return fclose(file) == 0 ? YES : NO;
+}
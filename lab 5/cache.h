@@ -0,0 +1,70 @@
+/*******************************************************************************
+ * Joseph Adams
+ *
+ * cache.h is a header file to be used in the source file sudoku.c
+ *
+ * cache.h defines the Cache struct, which remembers the results of puzzles
+ * by their canonical form from canon.h, along with the functions used to
+ * look them up and add them, and to save the cache to a file and load it
+ * again. A cache holds at most a fixed number of puzzles; when it is full,
+ * the one used least recently is forgotten to make room.
+*******************************************************************************/
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <pthread.h>
+#include "solver.h"
+
+struct CacheEntry
+{
+  char puzzle[CELLS];   /* canonical form of the puzzle */
+  char solution[CELLS]; /* its solution, if it has one */
+  int result;           /* result of the puzzle, as chosen by the caller */
+  int found;            /* solutions counted, as chosen by the caller */
+  int chain;            /* next entry with the same hash, or -1 */
+  int newer;            /* entry used next after this one, or -1 */
+  int older;            /* entry used last before this one, or -1 */
+};
+
+struct Cache
+{
+  struct CacheEntry* entries;
+  int capacity;         /* most entries, 0 if there is no cache */
+  int used;             /* entries holding a puzzle */
+  int* buckets;         /* first entry of each hash chain, or -1 */
+  int bucket_count;     /* a power of two, at least capacity */
+  int newest;           /* entry used most recently, or -1 */
+  int oldest;           /* entry used least recently, or -1 */
+  unsigned long hits;
+  unsigned long misses;
+  pthread_mutex_t lock; /* held while the cache is read or changed */
+};
+
+/* Make cache able to hold capacity entries. Return YES, or NO if there is
+ * not enough memory. */
+int cache_init(struct Cache* cache, int capacity);
+
+/* Free the memory used by cache. */
+void cache_free(struct Cache* cache);
+
+/* Look for the canonical puzzle in cache. If it is there, mark it as just
+ * used, copy out its result, count and solution, and return YES. */
+int cache_lookup(struct Cache* cache, const char* puzzle, int* result,
+                 int* found, char* solution);
+
+/* Add the canonical puzzle to cache, forgetting the least recently used
+ * entry if it is full. solution may be NULL. */
+void cache_insert(struct Cache* cache, const char* puzzle, int result,
+                  int found, const char* solution);
+
+/* Add the entries saved in the file called name. The file is ignored
+ * unless it was saved with the same puzzle size and tag. Return NO if the
+ * file exists but cannot be read. */
+int cache_load(struct Cache* cache, const char* name, long tag);
+
+/* Save every entry of cache to the file called name, with tag. Return NO
+ * if it cannot be written. */
+int cache_save(struct Cache* cache, const char* name, long tag);
+
+#endif
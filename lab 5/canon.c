@@ -0,0 +1,480 @@
+/*******************************************************************************
+ * Joseph Adams
+ *
+ * canon.c is a source file implementing the functions found in canon.h.
+ * These functions are used to find the canonical form of a puzzle, so that
+ * puzzles which are the same up to symmetry can share one solution.
+ *
+ * The canonical form is the smallest puzzle that can be reached by the
+ * symmetries, comparing first the pattern of filled entries and then the
+ * digits. The pattern is read row by row, with a filled entry counting as 1
+ * and a blank as 0, so the smallest pattern has its blanks as far up and to
+ * the left as they can go. The digits are then relabelled in the order they
+ * first appear, which makes the digit string as small as possible for that
+ * arrangement.
+ *
+ * Trying every arrangement would mean 2*6^8 of them for a 9x9 puzzle, so the
+ * pattern is built one row at a time. Each row is the smallest that any
+ * source row allowed in that position can give under the column orders
+ * still possible, and only the source rows that give it are followed
+ * further. The column orders still possible are kept as ties: stacks that
+ * may still trade places, and columns within a stack that may. A new row
+ * can only break ties, never make them, so usually just a handful of
+ * arrangements reach the last row, and only they are compared digit by
+ * digit.
+*******************************************************************************/
+
+
+
+#include <string.h>
+#include "canon.h"
+
+
+/*******************************************************************************
+ * start_layout() sets up a layout with no rows chosen, in which every stack
+ * may take any stack position and every column any place within its stack.
+*******************************************************************************/
+
+static void start_layout(struct Layout* layout, int transposed)
+{
+  int s;
+  int k;
+  for (s = 0; s < BOX; s++)
+    {
+      layout->stack[s] = s;
+      layout->stack_tie[s] = s < BOX - 1;
+      for (k = 0; k < BOX; k++)
+        {
+          layout->col[s][k] = k;
+          layout->col_tie[s][k] = k < BOX - 1;
+        }
+    }
+  layout->transposed = transposed;
+}
+
+/*******************************************************************************
+ * refine() makes pattern, the filled entries of a source row, as small as
+ * the ties of layout allow, and narrows the ties to the column orders that
+ * give that row. Within each group of tied columns the blanks go first, and
+ * the group splits in two where the blanks end. Each stack then has the
+ * string of bits its columns now give, and tied stacks are put in order of
+ * their strings, splitting where the strings differ. The row is left in
+ * value[], one string per stack position.
+*******************************************************************************/
+
+static void refine(struct Layout* layout, mask_t pattern, mask_t* value)
+{
+  mask_t bits[BOX];
+  int s;
+  int k;
+
+  for (s = 0; s < BOX; s++)
+    {
+      int* col = layout->col[s];
+      int* tie = layout->col_tie[s];
+      int start = 0;
+      bits[s] = 0;
+      for (k = 0; k < BOX; k++)
+        {
+          int filled = (pattern >> (s*BOX + col[k])) & 1;
+          int j = k;
+          /* Insertion sort of the group so far, blanks before filled. */
+          while (j > start && filled < ((pattern >> (s*BOX + col[j - 1])) & 1))
+            {
+              int temp = col[j];
+              col[j] = col[j - 1];
+              col[j - 1] = temp;
+              j--;
+            }
+          if (!tie[k]) start = k + 1;
+        }
+      for (k = 0; k < BOX; k++)
+        {
+          int filled = (pattern >> (s*BOX + col[k])) & 1;
+          bits[s] = bits[s] << 1 | filled;
+          if (k < BOX - 1 &&
+              filled != ((pattern >> (s*BOX + col[k + 1])) & 1)) tie[k] = NO;
+        }
+    }
+
+  for (k = 0; k < BOX; k++)
+    {
+      int j = k;
+      while (j > 0 && layout->stack_tie[j - 1] &&
+             bits[layout->stack[j]] < bits[layout->stack[j - 1]])
+        {
+          int temp = layout->stack[j];
+          layout->stack[j] = layout->stack[j - 1];
+          layout->stack[j - 1] = temp;
+          j--;
+        }
+    }
+  for (k = 0; k < BOX; k++)
+    {
+      value[k] = bits[layout->stack[k]];
+      if (k > 0 && value[k] != value[k - 1]) layout->stack_tie[k - 1] = NO;
+    }
+}
+
+/*******************************************************************************
+ * compare_rows() returns a negative number, 0 or a positive number as the
+ * row a is smaller than, equal to or larger than the row b.
+*******************************************************************************/
+
+static int compare_rows(const mask_t* a, const mask_t* b)
+{
+  int k;
+  for (k = 0; k < BOX; k++)
+    {
+      if (a[k] != b[k]) return a[k] < b[k] ? -1 : 1;
+    }
+  return 0;
+}
+
+/*******************************************************************************
+ * allowed() returns YES if source row r may become canonical row depth of
+ * layout. The first row of each band may be any row of a band not used yet,
+ * and the others must be unused rows of the same band.
+*******************************************************************************/
+
+static int allowed(const struct Layout* layout, int depth, int r)
+{
+  int k;
+  int first = depth - depth%BOX;
+  if (depth == first)
+    {
+      for (k = 0; k < depth; k += BOX)
+        {
+          if (layout->row[k]/BOX == r/BOX) return NO;
+        }
+      return YES;
+    }
+  if (layout->row[first]/BOX != r/BOX) return NO;
+  for (k = first; k < depth; k++)
+    {
+      if (layout->row[k] == r) return NO;
+    }
+  return YES;
+}
+
+/*******************************************************************************
+ * search_rows() chooses canonical row depth of layout. Every allowed source
+ * row is refined on a copy of layout, and the copies giving the smallest row
+ * found are kept in kept[depth]. That row is compared with best[depth]. If
+ * it is larger, this arrangement cannot lead to the canonical form. If it is
+ * smaller, everything found before is forgotten. Then each kept copy is
+ * followed to the next depth. A layout that reaches the last row is kept in
+ * leaves[]. Returns NO if CANON_WORK or CANON_LEAVES runs out.
+*******************************************************************************/
+
+static int search_rows(struct Canon* canon, const struct Layout* layout,
+                       int depth)
+{
+  const mask_t* pattern = canon->pattern[layout->transposed];
+  struct Layout* kept = canon->kept[depth];
+  int kept_count = 0;
+  mask_t value[BOX];
+  mask_t least[BOX];
+  int r;
+  int k;
+
+  if (depth == SIZE)
+    {
+      if (canon->leaf_count == CANON_LEAVES) return NO;
+      canon->leaves[canon->leaf_count++] = *layout;
+      return YES;
+    }
+  for (r = 0; r < SIZE; r++)
+    {
+      int order;
+      if (!allowed(layout, depth, r)) continue;
+      if (++canon->work > CANON_WORK) return NO;
+      kept[kept_count] = *layout;
+      kept[kept_count].row[depth] = r;
+      refine(&kept[kept_count], pattern[r], value);
+      order = kept_count ? compare_rows(value, least) : -1;
+      if (order < 0)
+        {
+          memcpy(least, value, sizeof(least));
+          kept[0] = kept[kept_count];
+          kept_count = 1;
+        }
+      else if (order == 0) kept_count++;
+    }
+
+  if (depth < canon->best_rows)
+    {
+      int order = compare_rows(least, canon->best[depth]);
+      if (order > 0) return YES;
+      if (order < 0) canon->best_rows = depth;
+    }
+  if (depth >= canon->best_rows)
+    {
+      memcpy(canon->best[depth], least, sizeof(least));
+      canon->best_rows = depth + 1;
+      canon->leaf_count = 0;
+    }
+
+  for (k = 0; k < kept_count; k++)
+    {
+      if (!search_rows(canon, &kept[k], depth + 1)) return NO;
+    }
+  return YES;
+}
+
+/*******************************************************************************
+ * next_order() steps the n numbers of a to the next larger permutation, as
+ * the C++ next_permutation() does. When a is already the largest, it is put
+ * back in increasing order and NO is returned.
+*******************************************************************************/
+
+static int next_order(int* a, int n)
+{
+  int i = n - 2;
+  int j = n - 1;
+  int wrapped;
+  int temp;
+  while (i >= 0 && a[i] >= a[i + 1]) i--;
+  wrapped = i < 0;
+  if (!wrapped)
+    {
+      while (a[j] <= a[i]) j--;
+      temp = a[i];
+      a[i] = a[j];
+      a[j] = temp;
+    }
+  for (j = n - 1, i++; i < j; i++, j--)
+    {
+      temp = a[i];
+      a[i] = a[j];
+      a[j] = temp;
+    }
+  return wrapped ? NO : YES;
+}
+
+/*******************************************************************************
+ * next_tie_order() steps layout to the next way of ordering its ties. The
+ * groups of tied columns and of tied stacks are counted through like the
+ * digits of an odometer, each one cycling through every order of its
+ * members. Returns NO once every combination has been seen. tie_group()
+ * returns the size of the group of ties starting at position k.
+*******************************************************************************/
+
+static int tie_group(const int* tie, int k)
+{
+  int end = k;
+  while (end < BOX - 1 && tie[end]) end++;
+  return end - k + 1;
+}
+
+static int next_tie_order(struct Layout* layout)
+{
+  int s;
+  int k;
+  int n;
+  for (s = 0; s < BOX; s++)
+    {
+      for (k = 0; k < BOX; k += n)
+        {
+          n = tie_group(layout->col_tie[s], k);
+          if (next_order(layout->col[s] + k, n)) return YES;
+        }
+    }
+  for (k = 0; k < BOX; k += n)
+    {
+      n = tie_group(layout->stack_tie, k);
+      if (next_order(layout->stack + k, n)) return YES;
+    }
+  return NO;
+}
+
+/*******************************************************************************
+ * sort_ties() puts every group of ties of layout in increasing order, which
+ * is where next_tie_order() starts counting.
+*******************************************************************************/
+
+static void sort_group(int* a, int n)
+{
+  int i;
+  for (i = 1; i < n; i++)
+    {
+      int j = i;
+      while (j > 0 && a[j - 1] > a[j])
+        {
+          int temp = a[j];
+          a[j] = a[j - 1];
+          a[j - 1] = temp;
+          j--;
+        }
+    }
+}
+
+static void sort_ties(struct Layout* layout)
+{
+  int s;
+  int k;
+  int n;
+  for (s = 0; s < BOX; s++)
+    {
+      for (k = 0; k < BOX; k += n)
+        {
+          n = tie_group(layout->col_tie[s], k);
+          sort_group(layout->col[s] + k, n);
+        }
+    }
+  for (k = 0; k < BOX; k += n)
+    {
+      n = tie_group(layout->stack_tie, k);
+      sort_group(layout->stack + k, n);
+    }
+}
+
+/*******************************************************************************
+ * try_digits() reads the puzzle in the arrangement given by layout with its
+ * ties broken in their current order, relabelling each digit as it first
+ * appears. If the result is smaller than canon->puzzle, or first is set, it
+ * becomes the new canonical form and the transform is saved. The comparison
+ * stops at the first digit that is larger.
+*******************************************************************************/
+
+static void try_digits(struct Canon* canon, const struct Layout* layout,
+                       int first)
+{
+  char puzzle[CELLS];
+  int col[SIZE];
+  int label[SIZE];
+  int next = 0;
+  int smaller = first;
+  int i;
+  int j;
+
+  for (i = 0; i < SIZE; i++)
+    {
+      int s = layout->stack[i/BOX];
+      col[i] = s*BOX + layout->col[s][i%BOX];
+      label[i] = -1;
+    }
+  for (i = 0; i < SIZE; i++)
+    {
+      for (j = 0; j < SIZE; j++)
+        {
+          int r = layout->row[i];
+          int c = col[j];
+          char ch = layout->transposed ? canon->line[c*SIZE + r] :
+            canon->line[r*SIZE + c];
+          int at = i*SIZE + j;
+          if (ch != '.')
+            {
+              int d = digit_value[(unsigned char)ch];
+              if (label[d] < 0) label[d] = next++;
+              ch = DIGITS[label[d]];
+              if (!smaller)
+                {
+                  int old = digit_value[(unsigned char)canon->puzzle[at]];
+                  if (label[d] > old) return;
+                  if (label[d] < old) smaller = YES;
+                }
+            }
+          puzzle[at] = ch;
+        }
+    }
+  if (!smaller) return;
+
+  memcpy(canon->puzzle, puzzle, CELLS);
+  canon->transposed = layout->transposed;
+  memcpy(canon->row, layout->row, sizeof(canon->row));
+  memcpy(canon->col, col, sizeof(canon->col));
+  for (i = 0; i < SIZE; i++)
+    {
+      if (label[i] < 0) label[i] = next++;
+      canon->inverse[i] = label[i];
+      canon->digit[label[i]] = i;
+    }
+}
+
+/*******************************************************************************
+ * canonicalize() first finds the pattern rows of the puzzle and of its
+ * transpose, then the smallest pattern and the layouts giving it with
+ * search_rows(), and finally compares the digits under every order of the
+ * ties left in those layouts.
+*******************************************************************************/
+
+int canonicalize(struct Canon* canon, const char* line)
+{
+  struct Layout layout;
+  int first = YES;
+  int i;
+  int j;
+
+  canon->line = line;
+  canon->best_rows = 0;
+  canon->leaf_count = 0;
+  canon->work = 0;
+  for (i = 0; i < SIZE; i++)
+    {
+      canon->pattern[0][i] = 0;
+      canon->pattern[1][i] = 0;
+    }
+  for (i = 0; i < SIZE; i++)
+    {
+      for (j = 0; j < SIZE; j++)
+        {
+          if (line[i*SIZE + j] != '.')
+            {
+              canon->pattern[0][i] |= (mask_t)1 << j;
+              canon->pattern[1][j] |= (mask_t)1 << i;
+            }
+        }
+    }
+
+  for (i = 0; i < 2; i++)
+    {
+      start_layout(&layout, i);
+      if (!search_rows(canon, &layout, 0)) return NO;
+    }
+  for (i = 0; i < canon->leaf_count; i++)
+    {
+      layout = canon->leaves[i];
+      sort_ties(&layout);
+      do
+        {
+          if (++canon->work > CANON_WORK) return NO;
+          try_digits(canon, &layout, first);
+          first = NO;
+        }
+      while (next_tie_order(&layout));
+    }
+  return YES;
+}
+
+/*******************************************************************************
+ * source_cell() returns the entry of the puzzle that canonical entry at
+ * became.
+*******************************************************************************/
+
+static int source_cell(const struct Canon* canon, int at)
+{
+  int r = canon->row[at/SIZE];
+  int c = canon->col[at%SIZE];
+  return canon->transposed ? c*SIZE + r : r*SIZE + c;
+}
+
+void canon_to_source(const struct Canon* canon, const char* from, char* to)
+{
+  int at;
+  for (at = 0; at < CELLS; at++)
+    {
+      int d = digit_value[(unsigned char)from[at]];
+      to[source_cell(canon, at)] = DIGITS[canon->digit[d]];
+    }
+}
+
+void canon_from_source(const struct Canon* canon, const char* from, char* to)
+{
+  int at;
+  for (at = 0; at < CELLS; at++)
+    {
+      int d = digit_value[(unsigned char)from[source_cell(canon, at)]];
+      to[at] = DIGITS[canon->inverse[d]];
+    }
+}
@@ -0,0 +1,71 @@
+/*******************************************************************************
+ * Joseph Adams
+ *
+ * canon.h is a header file to be used in the source file sudoku.c
+ *
+ * canon.h defines the Canon struct, which holds the canonical form of a
+ * puzzle and the transform that leads to it, along with canonicalize(),
+ * which finds them, and the functions that carry a solution between the
+ * puzzle and its canonical form.
+ *
+ * Two puzzles have the same canonical form exactly when one can be turned
+ * into the other by relabelling the digits, swapping rows within a band,
+ * swapping whole bands, doing the same to columns and stacks, and
+ * transposing. Such puzzles have the same number of solutions, and the
+ * solutions correspond under the same transform.
+*******************************************************************************/
+
+#ifndef CANON_H
+#define CANON_H
+
+#include "solver.h"
+
+#define CANON_LEAVES 64
+/*CANON_LEAVES is the most row orders kept while looking for the form.*/
+#define CANON_WORK 20000
+/*
+ * CANON_WORK bounds the rows tried and the column orders compared for one
+ * puzzle. A puzzle with so much symmetry that this is not enough gets no
+ * canonical form, and is simply solved.
+ */
+
+struct Layout
+{
+  int row[SIZE];         /* source row of each canonical row chosen so far */
+  int stack[BOX];        /* source stack in each stack position */
+  int stack_tie[BOX];    /* YES if stack position k may swap with k + 1 */
+  int col[BOX][BOX];     /* column order within each source stack */
+  int col_tie[BOX][BOX]; /* YES if column k of a stack may swap with k + 1 */
+  int transposed;        /* YES if the puzzle is read column by column */
+};
+
+struct Canon
+{
+  char puzzle[CELLS];  /* the canonical form, using '.' and DIGITS */
+  int transposed;      /* YES if the puzzle was transposed */
+  int row[SIZE];       /* source row of each canonical row */
+  int col[SIZE];       /* source column of each canonical column */
+  int digit[SIZE];     /* source digit of each canonical digit */
+  int inverse[SIZE];   /* canonical digit of each source digit */
+  const char* line;    /* the puzzle being canonicalized */
+  mask_t pattern[2][SIZE]; /* filled entries of each row, and each column */
+  mask_t best[SIZE][BOX];  /* smallest pattern found for each row */
+  int best_rows;           /* rows of best[] that are known */
+  struct Layout kept[SIZE][SIZE];     /* row choices being followed */
+  struct Layout leaves[CANON_LEAVES]; /* row orders giving the best pattern */
+  int leaf_count;
+  long work;               /* rows tried and column orders compared */
+};
+
+/* Find the canonical form of the CELLS character puzzle line, which must
+ * already have passed check_line(). Return YES, or NO if the puzzle has too
+ * much symmetry for the form to be found within CANON_WORK. */
+int canonicalize(struct Canon* canon, const char* line);
+
+/* Turn a solution of canon->puzzle into the solution of the puzzle. */
+void canon_to_source(const struct Canon* canon, const char* from, char* to);
+
+/* Turn a solution of the puzzle into the solution of canon->puzzle. */
+void canon_from_source(const struct Canon* canon, const char* from, char* to);
+
+#endif
@@ -0,0 +1,236 @@
+/*******************************************************************************
+ * Joseph Adams
+ *
+ * dlx.c is a source file implementing the functions found in dlx.h. It solves
+ * a sudoku as an exact cover problem: choose matrix rows (digit placements)
+ * so that every one of the DLX_COLUMNS columns (constraints) is covered
+ * exactly once.
+ *
+ * The matrix is stored as circular doubly linked lists in the arrays of the
+ * DancingLinks struct. Node 0 is the root, nodes 1 to 324 are the column
+ * headers and the rest are the 1's of the matrix. Removing a node from its
+ * list leaves its own links intact, so it can be put back in O(1) when the
+ * search backs up.
+*******************************************************************************/
+
+
+
+#include "dlx.h"
+#include "stats.h"
+
+
+/*******************************************************************************
+ * add_node() appends node n, belonging to matrix row r, to the bottom of
+ * column col. It is only used while the matrix is being built.
+*******************************************************************************/
+
+static void add_node(struct DancingLinks* dlx, int n, int col, int r)
+{
+  dlx->column[n] = col;
+  dlx->row[n] = r;
+  dlx->up[n] = dlx->up[col];
+  dlx->down[n] = col;
+  dlx->down[dlx->up[col]] = n;
+  dlx->up[col] = n;
+  dlx->size[col]++;
+}
+
+/*******************************************************************************
+ * build() fills in the full DLX_COLUMNS column, DLX_ROWS row matrix. Matrix
+ * row r stands for digit d at position i,j where r = (i*SIZE + j)*SIZE + d.
+ * Its four nodes are linked into a circular row list so the search can
+ * reach the other columns the row covers.
+*******************************************************************************/
+
+static void build(struct DancingLinks* dlx)
+{
+  int n;
+  int r;
+  for(n = 0; n <= DLX_COLUMNS; n++)
+    {
+      dlx->left[n] = (n == 0) ? DLX_COLUMNS : n - 1;
+      dlx->right[n] = (n == DLX_COLUMNS) ? 0 : n + 1;
+      dlx->up[n] = n;
+      dlx->down[n] = n;
+      dlx->size[n] = 0;
+    }
+  for(r = 0; r < DLX_ROWS; r++)
+    {
+      int pos = r/SIZE;
+      int i = pos/SIZE;
+      int j = pos%SIZE;
+      int d = r%SIZE;
+      int k;
+      n = 1 + DLX_COLUMNS + 4*r;
+      add_node(dlx, n, 1 + pos, r);
+      add_node(dlx, n + 1, 1 + CELLS + i*SIZE + d, r);
+      add_node(dlx, n + 2, 1 + 2*CELLS + j*SIZE + d, r);
+      add_node(dlx, n + 3, 1 + 3*CELLS + ((i/BOX)*BOX + j/BOX)*SIZE + d, r);
+      for(k = 0; k < 4; k++)
+        {
+          dlx->right[n + k] = n + (k + 1)%4;
+          dlx->left[n + k] = n + (k + 3)%4;
+        }
+    }
+  dlx->depth = 0;
+}
+
+/*******************************************************************************
+ * cover() removes column col from the header list, and removes every row
+ * that has a node in col from all the other columns it appears in.
+ * uncover() undoes cover() by putting everything back in reverse order.
+*******************************************************************************/
+
+static void cover(struct DancingLinks* dlx, int col)
+{
+  int i;
+  int j;
+  dlx->right[dlx->left[col]] = dlx->right[col];
+  dlx->left[dlx->right[col]] = dlx->left[col];
+  for(i = dlx->down[col]; i != col; i = dlx->down[i])
+    {
+      for(j = dlx->right[i]; j != i; j = dlx->right[j])
+        {
+          dlx->down[dlx->up[j]] = dlx->down[j];
+          dlx->up[dlx->down[j]] = dlx->up[j];
+          dlx->size[dlx->column[j]]--;
+        }
+    }
+}
+
+static void uncover(struct DancingLinks* dlx, int col)
+{
+  int i;
+  int j;
+  for(i = dlx->up[col]; i != col; i = dlx->up[i])
+    {
+      for(j = dlx->left[i]; j != i; j = dlx->left[j])
+        {
+          dlx->size[dlx->column[j]]++;
+          dlx->down[dlx->up[j]] = j;
+          dlx->up[dlx->down[j]] = j;
+        }
+    }
+  dlx->right[dlx->left[col]] = col;
+  dlx->left[dlx->right[col]] = col;
+}
+
+/*******************************************************************************
+ * search() is Algorithm X. If no columns are left, every constraint is met,
+ * so the chosen rows are a solution. The first one is copied into first,
+ * count is increased, and YES is returned once count reaches limit so every
+ * caller can stop at once. Otherwise it picks the column with the fewest
+ * nodes, since that is the constraint with the fewest ways to be satisfied,
+ * and tries each of its rows in turn. Choosing a row covers all of its
+ * columns; if the recursive search does not stop they are uncovered in
+ * reverse order and the next row is tried. A column of size 0 means the
+ * choices so far are wrong, and the loop over its rows simply does nothing
+ * before returning NO.
+ *
+ * If node_limit or the deadline is passed, timed_out is set and YES is
+ * returned, which stops the search in the same way as reaching the limit.
+ * The clock is only read every 256 nodes since it costs far more than one.
+*******************************************************************************/
+
+static int search(struct DancingLinks* dlx)
+{
+  int col;
+  int best;
+  int r;
+  int j;
+
+  dlx->stats.nodes++;
+  if((dlx->node_limit && dlx->stats.nodes > dlx->node_limit) ||
+     (dlx->deadline && (dlx->stats.nodes & 255) == 0 &&
+      latency_now() > dlx->deadline))
+    {
+      dlx->timed_out = YES;
+      return YES;
+    }
+  if(dlx->depth > dlx->stats.max_depth) dlx->stats.max_depth = dlx->depth;
+  if(dlx->right[0] == 0)
+    {
+      if(dlx->count == 0)
+        {
+          for(j = 0; j < dlx->depth; j++)
+            {
+              int row = dlx->solution[j];
+              dlx->first[row/SIZE] = DIGITS[row%SIZE];
+            }
+        }
+      dlx->count++;
+      return dlx->count >= dlx->limit ? YES : NO;
+    }
+  best = dlx->right[0];
+  for(col = dlx->right[best]; col != 0; col = dlx->right[col])
+    {
+      if(dlx->size[col] < dlx->size[best])
+        {
+          best = col;
+          if(dlx->size[best] <= 1) break;
+        }
+    }
+  cover(dlx, best);
+  for(r = dlx->down[best]; r != best; r = dlx->down[r])
+    {
+      dlx->solution[dlx->depth++] = dlx->row[r];
+      for(j = dlx->right[r]; j != r; j = dlx->right[j])
+        {
+          cover(dlx, dlx->column[j]);
+        }
+      if(search(dlx)) return YES;
+      for(j = dlx->left[r]; j != r; j = dlx->left[j])
+        {
+          uncover(dlx, dlx->column[j]);
+        }
+      dlx->depth--;
+      dlx->stats.backtracks++;
+    }
+  uncover(dlx, best);
+  return NO;
+}
+
+/*******************************************************************************
+ * dlx_count() builds the matrix, then selects the matrix row of every hint by
+ * covering its four columns, exactly as search() would have. What is left is
+ * the exact cover problem for the blank entries, which search() solves until
+ * it has found limit covers. The hints are copied into first, so the blanks
+ * filled in by the first cover complete the solution that goes back into
+ * grid. dlx_solve() is simply dlx_count() with a limit of 1.
+*******************************************************************************/
+
+int dlx_count(struct DancingLinks* dlx, char* grid, int limit)
+{
+  int pos;
+  int k;
+  build(dlx);
+  dlx->limit = limit;
+  dlx->count = 0;
+  dlx->timed_out = NO;
+  dlx->deadline = dlx->time_limit ? latency_now() + dlx->time_limit : 0;
+  dlx->stats.nodes = 0;
+  dlx->stats.backtracks = 0;
+  dlx->stats.propagations = 0;
+  dlx->stats.max_depth = 0;
+  for(pos = 0; pos < CELLS; pos++)
+    {
+      dlx->first[pos] = grid[pos];
+      if(grid[pos] != '.')
+        {
+          int d = digit_value[(unsigned char)grid[pos]];
+          int n = 1 + DLX_COLUMNS + 4*(pos*SIZE + d);
+          for(k = 0; k < 4; k++) cover(dlx, dlx->column[n + k]);
+        }
+    }
+  search(dlx);
+  if(dlx->count > 0)
+    {
+      for(pos = 0; pos < CELLS; pos++) grid[pos] = dlx->first[pos];
+    }
+  return dlx->count;
+}
+
+int dlx_solve(struct DancingLinks* dlx, char* grid)
+{
+  return dlx_count(dlx, grid, 1) > 0 && !dlx->timed_out ? YES : NO;
+}
@@ -0,0 +1,59 @@
+/*******************************************************************************
+ * Joseph Adams
+ *
+ * dlx.h is a header file to be used in the source file sudoku.c
+ *
+ * dlx.h defines the DancingLinks struct, which holds a sudoku as an exact
+ * cover matrix, along with dlx_solve(), which solves it using Knuth's
+ * Algorithm X with dancing links, and dlx_count(), which counts solutions.
+*******************************************************************************/
+
+#ifndef DLX_H
+#define DLX_H
+
+#include "solver.h"
+
+#define DLX_COLUMNS (4*CELLS)
+/*
+ * Every sudoku constraint is one column: CELLS for "entry i,j is filled",
+ * CELLS for "row i has digit d", CELLS for "column j has digit d" and CELLS
+ * for "block b has digit d". That is 324 columns for a 9x9 puzzle.
+ */
+#define DLX_ROWS (CELLS*SIZE)
+/*Every choice of digit d at position i,j is one matrix row with 4 nodes.*/
+#define DLX_NODES (1 + DLX_COLUMNS + 4*DLX_ROWS)
+
+struct DancingLinks
+{
+  int left[DLX_NODES];
+  int right[DLX_NODES];
+  int up[DLX_NODES];
+  int down[DLX_NODES];
+  int column[DLX_NODES]; /* column header of each node */
+  int row[DLX_NODES];    /* matrix row (position*SIZE + digit) of each node */
+  int size[DLX_COLUMNS + 1]; /* nodes left in each column */
+  int solution[CELLS];   /* matrix rows chosen so far */
+  int depth;             /* number of rows in solution[] */
+  int limit;             /* stop searching once count reaches this */
+  int count;             /* solutions found so far */
+  char first[CELLS];     /* the first solution found */
+  struct SearchStats stats; /* work done on the last puzzle */
+  unsigned long node_limit; /* most nodes a search may use, 0 for no limit */
+  unsigned long time_limit; /* most ns a search may take, 0 for no limit */
+  unsigned long deadline;   /* clock reading time_limit after the start */
+  int timed_out;            /* set if the last search hit a limit */
+};
+
+/* Solve the CELLS character puzzle in grid, using '.' for blanks.
+ * The hints must already be known to be legal.
+ * Fill in the blanks and return 1 if there is a solution, otherwise
+ * leave grid unchanged and return 0. */
+int dlx_solve(struct DancingLinks* dlx, char* grid);
+
+/* Count the solutions of grid, stopping once limit have been found.
+ * Return the number found and copy the first one into grid.
+ * Both functions give up and set timed_out if node_limit or time_limit
+ * is reached. */
+int dlx_count(struct DancingLinks* dlx, char* grid, int limit);
+
+#endif
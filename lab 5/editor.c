@@ -0,0 +1,237 @@
+/*******************************************************************************
+ * Joseph Adams
+ *
+ * editor.c is a source file implementing the functions found in editor.h.
+ * These functions are used to solve a puzzle again after each hint added
+ * or removed, reusing the work done for the last version of it.
+ *
+ * The Sudoku of an Editor always holds the hints it was loaded with, then
+ * the hints added since in edit[], each placed with place_digit() after
+ * recording the trail mark before it. A search is run from there and then
+ * undone, so the placed and propagated hints are never worked out twice.
+ * Removing a hint of edit[] only undoes the trail back to its mark and
+ * places the hints after it again. Removing a hint it was loaded with, or
+ * any change while two hints clash, loads the puzzle afresh, which still
+ * takes only microseconds and makes every current hint part of the load.
+*******************************************************************************/
+
+#include <string.h>
+#include "editor.h"
+
+#define ADDED 0
+#define REMOVED 1
+#define REPLACED 2
+/*These are the kinds of change that solve_again() is told about.*/
+
+/*******************************************************************************
+ * clashes() returns YES if the hint at pos is repeated elsewhere in its
+ * row, column or block.
+*******************************************************************************/
+
+static int clashes(const char* hints, int pos)
+{
+  int row = pos/SIZE;
+  int col = pos%SIZE;
+  int k;
+  for (k = 0; k < SIZE; k++)
+    {
+      int box_pos = ((row/BOX)*BOX + k/BOX)*SIZE + (col/BOX)*BOX + k%BOX;
+      if ((row*SIZE + k != pos && hints[row*SIZE + k] == hints[pos]) ||
+          (k*SIZE + col != pos && hints[k*SIZE + col] == hints[pos]) ||
+          (box_pos != pos && hints[box_pos] == hints[pos])) return YES;
+    }
+  return NO;
+}
+
+/*******************************************************************************
+ * reload() loads every current hint into the Sudoku and propagates them,
+ * leaving edit[] empty. If the hints clash, legal is NO. If they clash or
+ * propagating them finds a contradiction, loaded is NO and the Sudoku is
+ * not used until the next reload().
+*******************************************************************************/
+
+static void reload(struct Editor* editor)
+{
+  editor->edit_count = 0;
+  editor->placed = 0;
+  editor->legal = load_sudoku(&editor->sudoku, editor->hints);
+  editor->loaded = editor->legal && deduce(&editor->sudoku);
+}
+
+/*******************************************************************************
+ * place_edits() places the hints of edit[] that are not placed yet, in
+ * order. A hint that leaves no solution is undone straight away, so the
+ * Sudoku is never left holding a contradiction; it and the hints after it
+ * stay unplaced, which is how solve_again() knows there is no solution.
+*******************************************************************************/
+
+static void place_edits(struct Editor* editor)
+{
+  struct Sudoku* sudoku = &editor->sudoku;
+  if (!editor->loaded) return;
+  while (editor->placed < editor->edit_count)
+    {
+      int pos = editor->edit[editor->placed];
+      editor->mark[editor->placed] = sudoku->trail_count;
+      if (!place_digit(sudoku, pos,
+                       digit_value[(unsigned char)editor->hints[pos]]))
+        {
+          undo_changes(sudoku, editor->mark[editor->placed]);
+          break;
+        }
+      editor->placed++;
+    }
+}
+
+/*******************************************************************************
+ * take_hint() blanks the hint at pos. If it is in edit[], the trail is
+ * undone back to its mark, if it was placed, and it is taken out of the
+ * list; the hints after it are placed again by place_edits(). Otherwise it
+ * was loaded, and the puzzle must be reloaded, in which case NO is
+ * returned.
+*******************************************************************************/
+
+static int take_hint(struct Editor* editor, int pos)
+{
+  int k;
+  editor->hints[pos] = '.';
+  for (k = 0; k < editor->edit_count; k++)
+    {
+      if (editor->edit[k] == pos) break;
+    }
+  if (k == editor->edit_count) return NO;
+  if (k < editor->placed)
+    {
+      undo_changes(&editor->sudoku, editor->mark[k]);
+      editor->placed = k;
+    }
+  editor->edit_count--;
+  memmove(&editor->edit[k], &editor->edit[k + 1],
+          (editor->edit_count - k)*sizeof(int));
+  return YES;
+}
+
+/*******************************************************************************
+ * solve_again() works out the result after a change to the hint at pos.
+ * Clashing hints are an ERROR, and a hint that could not be placed means
+ * there is no solution. Otherwise the last result is reused when it must
+ * still hold:
+ *
+ * - a new hint that agrees with the solution, when that was the only one
+ *   found, leaves it the only one;
+ * - a new hint cannot give a puzzle with no solution one;
+ * - taking a hint away only adds solutions, so if limit of them had been
+ *   found, they are still there.
+ *
+ * Otherwise the Sudoku is searched with count_solutions() and put back the
+ * way it was, ready for the next change. The grid is saved first, since
+ * count_solutions() leaves the solution in it.
+*******************************************************************************/
+
+static void solve_again(struct Editor* editor, int change, int pos)
+{
+  struct Sudoku* sudoku = &editor->sudoku;
+  char grid[CELLS];
+  int mark;
+
+  editor->searched = NO;
+  if (!editor->loaded || editor->placed < editor->edit_count)
+    {
+      editor->result = editor->legal ? NO_SOLUTION : ERROR;
+      editor->found = 0;
+      return;
+    }
+  if (change == ADDED && editor->found == 1 &&
+      editor->solution[pos] == editor->hints[pos]) return;
+  if (change == ADDED && editor->result == NO_SOLUTION) return;
+  if (change == REMOVED && editor->found == editor->limit) return;
+
+  memcpy(grid, sudoku->grid, CELLS);
+  mark = sudoku->trail_count;
+  sudoku->timed_out = NO;
+  editor->found = count_solutions(sudoku, editor->limit);
+  if (editor->found > 0) memcpy(editor->solution, sudoku->grid, CELLS);
+  undo_changes(sudoku, mark);
+  memcpy(sudoku->grid, grid, CELLS);
+  editor->searched = YES;
+
+  if (sudoku->timed_out)
+    {
+      editor->result = TIMEOUT;
+      editor->found = 0;
+    }
+  else if (editor->found == 0) editor->result = NO_SOLUTION;
+  else if (editor->found == 1) editor->result = SOLVED;
+  else editor->result = MULTIPLE;
+}
+
+void editor_init(struct Editor* editor, int limit, unsigned long node_limit,
+                 unsigned long time_limit)
+{
+  editor->limit = limit;
+  editor->sudoku.node_limit = node_limit;
+  editor->sudoku.time_limit = time_limit;
+  editor->sudoku.share = NULL;
+  editor->sudoku.team = NULL;
+}
+
+int editor_load(struct Editor* editor, const char* puzzle)
+{
+  int pos;
+  for (pos = 0; pos < CELLS; pos++)
+    {
+      if (puzzle[pos] != '.' && digit_value[(unsigned char)puzzle[pos]] < 0)
+        {
+          return NO;
+        }
+    }
+  memcpy(editor->hints, puzzle, CELLS);
+  reload(editor);
+  editor->found = 0;
+  editor->result = NO_SOLUTION;
+  solve_again(editor, REPLACED, 0);
+  return YES;
+}
+
+int editor_add(struct Editor* editor, int pos, char digit)
+{
+  int change = ADDED;
+  int placed = YES;
+
+  if (pos < 0 || pos >= CELLS || digit_value[(unsigned char)digit] < 0)
+    {
+      return NO;
+    }
+  editor->searched = NO;
+  memset(&editor->sudoku.stats, 0, sizeof(struct SearchStats));
+  if (editor->hints[pos] == digit) return YES;
+  if (editor->hints[pos] != '.')
+    {
+      placed = take_hint(editor, pos);
+      change = REPLACED;
+    }
+  editor->hints[pos] = digit;
+  if (!placed || !editor->loaded || clashes(editor->hints, pos))
+    {
+      reload(editor);
+    }
+  else
+    {
+      editor->edit[editor->edit_count++] = pos;
+      place_edits(editor);
+    }
+  solve_again(editor, change, pos);
+  return YES;
+}
+
+int editor_remove(struct Editor* editor, int pos)
+{
+  if (pos < 0 || pos >= CELLS) return NO;
+  editor->searched = NO;
+  memset(&editor->sudoku.stats, 0, sizeof(struct SearchStats));
+  if (editor->hints[pos] == '.') return YES;
+  if (!take_hint(editor, pos) || !editor->loaded) reload(editor);
+  else place_edits(editor);
+  solve_again(editor, REMOVED, pos);
+  return YES;
+}
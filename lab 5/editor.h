@@ -0,0 +1,64 @@
+/*******************************************************************************
+ * Joseph Adams
+ *
+ * editor.h is a header file to be used in the source files editor.c and
+ * sudokuedit.c
+ *
+ * editor.h defines the Editor struct, which holds a puzzle that is being
+ * changed one hint at a time, as in a tool where someone is setting a
+ * puzzle by hand. After every change the puzzle is checked and solved
+ * again, but not from scratch: the Sudoku inside keeps the hints placed
+ * and propagated, and the last solution found is kept too.
+ *
+ * Adding a hint places it on top of the propagated state. Removing a hint
+ * undoes the trail back to where it was placed and places the later ones
+ * again. Often no search is needed at all: a solution that agrees with a
+ * new hint, or had one more hint than the puzzle now has, is still a
+ * solution, and a puzzle that was unique stays unique when a hint is
+ * added.
+ *
+ * There is no global state, so each thread can use its own Editor.
+ * solver_init() must have been called first.
+*******************************************************************************/
+
+#ifndef EDITOR_H
+#define EDITOR_H
+
+#include "solver.h"
+
+struct Editor
+{
+  struct Sudoku sudoku;   /* the hints placed and propagated, no guesses */
+  char hints[CELLS];      /* the puzzle as edited, '.' for blank */
+  int legal;              /* NO if two hints clash */
+  int loaded;             /* NO if the hints clash or cannot be propagated */
+  int edit[CELLS];        /* entries given a hint since the last load */
+  int mark[CELLS];        /* trail_count before each of them was placed */
+  int edit_count;         /* entries in edit[] */
+  int placed;             /* edits at the front of edit[] placed in sudoku */
+  int limit;              /* solutions to count, 2 to check uniqueness */
+  int result;             /* SOLVED, ERROR, NO_SOLUTION, MULTIPLE, TIMEOUT */
+  int found;              /* solutions counted, up to limit */
+  char solution[CELLS];   /* the first solution, if found is not 0 */
+  int searched;           /* set if the last change needed a search */
+};
+
+/* Set up editor to count up to limit solutions of each puzzle, 1 to just
+ * find one, with the given node and time limits (0 for none). */
+void editor_init(struct Editor* editor, int limit, unsigned long node_limit,
+                 unsigned long time_limit);
+
+/* Start editing the CELLS character puzzle, using '.' for blanks, and
+ * solve it. Return NO if it holds any other character. */
+int editor_load(struct Editor* editor, const char* puzzle);
+
+/* Put the hint digit, a character of DIGITS, at the entry pos, replacing
+ * any hint already there, and solve the puzzle again. Return NO if pos or
+ * digit is out of range. */
+int editor_add(struct Editor* editor, int pos, char digit);
+
+/* Take away the hint at pos, if there is one, and solve the puzzle again.
+ * Return NO if pos is out of range. */
+int editor_remove(struct Editor* editor, int pos);
+
+#endif
@@ -0,0 +1,175 @@
+/*******************************************************************************
+ * Joseph Adams
+ *
+ * engine.c is a source file implementing the functions found in engine.h.
+ * They take a puzzle line through the checks of solver.c and then hand it
+ * to whichever engine was chosen: solve() or count_solutions() in solver.c,
+ * a team of threads from team.c, Dancing Links in dlx.c or the CDCL solver
+ * in sat.c, with the cache of cache.c in front of them if there is one.
+*******************************************************************************/
+
+
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <string.h>
+#include "io.h"
+#include "engine.h"
+
+
+/*******************************************************************************
+ * engine_search() returns the search counts of the engine of engine->kind,
+ * from the solver state of worker, and sets *timed_out if that engine gave
+ * up on its last puzzle.
+*******************************************************************************/
+
+const struct SearchStats* engine_search(const struct Engine* engine,
+                                        struct Worker* worker,
+                                        int* timed_out)
+{
+  if (engine->kind == DLX)
+    {
+      *timed_out = worker->dlx.timed_out;
+      return &worker->dlx.stats;
+    }
+  if (engine->kind == SAT)
+    {
+      *timed_out = worker->sat.timed_out;
+      return &worker->sat.stats;
+    }
+  *timed_out = worker->sudoku.timed_out;
+  return &worker->sudoku.stats;
+}
+
+/*******************************************************************************
+ * run_engine() solves the puzzle loaded in the solver state of worker with
+ * the engine of engine->kind and returns the result. When solutions are
+ * being counted, the number found is left in *found. If team_size is more
+ * than 1, the backtracking search is done by the team of the worker.
+*******************************************************************************/
+
+static int run_engine(const struct Engine* engine, struct Worker* worker,
+                      int* found)
+{
+  struct Sudoku* sudoku = &worker->sudoku;
+  int limit = engine->count_limit;
+  int result = NO_SOLUTION;
+  int timed_out;
+
+  if (limit)
+    {
+      if (engine->kind == DLX)
+        {
+          *found = dlx_count(&worker->dlx, sudoku->grid, limit);
+        }
+      else if (engine->kind == SAT)
+        {
+          *found = sat_count(&worker->sat, sudoku->grid, limit);
+        }
+      else if (engine->team_size > 1)
+        {
+          *found = team_count(&worker->team, sudoku, limit);
+        }
+      else *found = count_solutions(sudoku, limit);
+      if (*found == 1) result = SOLVED;
+      else if (*found > 1) result = MULTIPLE;
+    }
+  else if (engine->kind == DLX)
+    {
+      if (dlx_solve(&worker->dlx, sudoku->grid)) result = SOLVED;
+    }
+  else if (engine->kind == SAT)
+    {
+      if (sat_solve(&worker->sat, sudoku->grid)) result = SOLVED;
+    }
+  else if (engine->team_size > 1)
+    {
+      if (team_count(&worker->team, sudoku, 1)) result = SOLVED;
+    }
+  else if (solve(sudoku)) result = SOLVED;
+
+  if (engine_search(engine, worker, &timed_out) && timed_out)
+    {
+      result = TIMEOUT;
+    }
+  return result;
+}
+
+/*******************************************************************************
+ * cached_engine() is run_engine() with the cache in front of it. The
+ * puzzle is looked up by its canonical form, and a solution found there is
+ * carried back through the transform to the puzzle as given. Otherwise the
+ * puzzle is solved and its result is added to the cache, unless it timed
+ * out, since another run with other limits might finish it. A puzzle with
+ * too much symmetry to canonicalize is simply solved.
+*******************************************************************************/
+
+static int cached_engine(const struct Engine* engine, struct Worker* worker,
+                         const char* line, int* found)
+{
+  struct Canon* canon = &worker->canon;
+  char solution[CELLS];
+  int result;
+
+  if (!canonicalize(canon, line)) return run_engine(engine, worker, found);
+  if (cache_lookup(engine->cache, canon->puzzle, &result, found, solution))
+    {
+      if (result == SOLVED)
+        {
+          canon_to_source(canon, solution, worker->sudoku.grid);
+        }
+      return result;
+    }
+  result = run_engine(engine, worker, found);
+  if (result == SOLVED)
+    {
+      canon_from_source(canon, worker->sudoku.grid, solution);
+      cache_insert(engine->cache, canon->puzzle, result, *found, solution);
+    }
+  else if (result != TIMEOUT)
+    {
+      cache_insert(engine->cache, canon->puzzle, result, *found, NULL);
+    }
+  return result;
+}
+
+/*******************************************************************************
+ * solve_puzzle() calls the functions in a sensible order. check_line() and
+ * load_sudoku() look for errors, and if they find any the result is ERROR.
+ * Otherwise no_solution_check() is executed as yet another preliminary
+ * test. If this passes and we were handed an already solved sudoku, it is
+ * its own solution. If not, run_engine() or cached_engine() is invoked.
+ *
+ * When solutions are being counted, a puzzle with fewer than 17 hints is
+ * not rejected up front, since count_solutions(), dlx_count() or
+ * sat_count() will find out for certain whether it is unique. A puzzle
+ * with more than one solution gets the result MULTIPLE.
+ *
+ * If the engine gave up at its node or time limit, the result is TIMEOUT
+ * whatever it had found so far, since it could not finish the job.
+*******************************************************************************/
+
+int solve_puzzle(const struct Engine* engine, struct Worker* worker,
+                 const char* line, int len, int checked, int* found)
+{
+  struct Sudoku* sudoku = &worker->sudoku;
+  int min_hints = engine->count_limit ? 0 : MIN_HINTS;
+
+  *found = 0;
+  worker->dlx.timed_out = NO;
+  memset(&worker->dlx.stats, 0, sizeof(struct SearchStats));
+  worker->sat.timed_out = NO;
+  memset(&worker->sat.stats, 0, sizeof(struct SearchStats));
+  if ((!checked && !check_line(line, len, min_hints)) ||
+      !load_sudoku(sudoku, line))
+    {
+      return ERROR;
+    }
+  if (no_solution_check(sudoku)) return NO_SOLUTION;
+  if (solved_check(sudoku)) return SOLVED;
+  if (engine->cache != NULL)
+    {
+      return cached_engine(engine, worker, line, found);
+    }
+  return run_engine(engine, worker, found);
+}
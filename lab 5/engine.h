@@ -0,0 +1,63 @@
+/*******************************************************************************
+ * Joseph Adams
+ *
+ * engine.h is a header file to be used in the source files sudoku.c and
+ * bench.c
+ *
+ * engine.h defines the Engine struct, which says how puzzles are to be
+ * solved, and the Worker struct, which holds the state of every solver for
+ * one thread. solve_puzzle() takes one line of input through the same
+ * checks and the same engine whichever program calls it, so the benchmark
+ * measures exactly what sudoku.c does.
+*******************************************************************************/
+
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <pthread.h>
+#include "solver.h"
+#include "dlx.h"
+#include "sat.h"
+#include "stats.h"
+#include "canon.h"
+#include "cache.h"
+#include "team.h"
+
+#define BACKTRACK 0
+#define DLX 1
+#define SAT 2
+/*These are the engines that can be chosen with the -e option.*/
+
+struct Engine
+{
+  int kind;            /* BACKTRACK, DLX or SAT */
+  int count_limit;     /* solutions counted up to, 0 to stop at the first */
+  int team_size;       /* threads searching each puzzle, for BACKTRACK */
+  struct Cache* cache; /* results by canonical form, or NULL for none */
+};
+
+struct Worker
+{
+  struct Sudoku sudoku;   /* backtracking solver state */
+  struct DancingLinks dlx; /* exact cover solver state */
+  struct SatSolver sat;   /* CDCL solver state */
+  struct Latency latency; /* times of the puzzles this worker solved */
+  struct Canon canon;     /* canonical form of the current puzzle */
+  struct Team team;       /* threads searching each puzzle, if any */
+  pthread_t thread;
+};
+
+/* Return the search counts of the engine of engine->kind from the solver
+ * state of worker, and set *timed_out if it gave up on its last puzzle. */
+const struct SearchStats* engine_search(const struct Engine* engine,
+                                        struct Worker* worker,
+                                        int* timed_out);
+
+/* Solve the len characters of line with worker and return the result. If
+ * checked is YES, line is already known to be a puzzle with enough hints.
+ * A solution is left in worker->sudoku.grid, and the number of solutions
+ * counted in *found. */
+int solve_puzzle(const struct Engine* engine, struct Worker* worker,
+                 const char* line, int len, int checked, int* found);
+
+#endif
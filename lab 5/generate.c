@@ -0,0 +1,401 @@
+/*******************************************************************************
+ * Joseph Adams
+ *
+ * generate.c is a program for making sudoku puzzles with exactly one
+ * solution. It writes them to the standard output stream one per line, in
+ * the same format that sudoku.c reads.
+ *
+ * Each puzzle starts as a random complete grid. The blocks on the diagonal
+ * share no row or column, so each is filled with its own random order of
+ * the digits and solve() completes the rest. The rows, columns, bands and
+ * stacks of the result are then shuffled, and it may be transposed, since
+ * none of that changes whether it is a valid grid.
+ *
+ * Hints are then taken away in a random order. After each one is removed,
+ * count_solutions() with a limit of 2 checks that the puzzle is still
+ * unique, and if it is not the hint is put back. This stops once the
+ * puzzle is down to the target number of hints, or once every hint has
+ * been tried. A hint that could not be removed can never be removed later,
+ * since taking away other hints only adds solutions, so in the second case
+ * the puzzle is minimal: removing any one of its hints makes it ambiguous.
+ *
+ * Puzzles are made in batches by several threads, like the batches solved
+ * by sudoku.c. The random numbers for puzzle n depend only on the seed and
+ * n, so a seed always gives the same puzzles in the same order whatever
+ * the number of threads.
+ *
+*******************************************************************************/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "solver.h"
+#include "stats.h"
+#include "io.h"
+
+#define BATCH_SIZE 1024
+/*BATCH_SIZE is the most puzzles made before they are written.*/
+#define MAX_THREADS 256
+#define FILL_NODES (10*CELLS)
+/*
+FILL_NODES is the most nodes solve() may use to complete the diagonal
+blocks. Most fills take about one node per row, but a few random starts
+send the search down a path that takes minutes, and a fresh start is far
+quicker than waiting for it.
+*/
+
+struct Generator
+{
+  struct Sudoku sudoku;    /* solver state used for the uniqueness checks */
+  unsigned long random;    /* state of the random number generator */
+  unsigned long checks;    /* uniqueness checks made */
+  pthread_t thread;
+};
+
+struct Batch
+{
+  char puzzle[BATCH_SIZE][CELLS];
+  long first;         /* number of the first puzzle of the batch */
+  int count;          /* puzzles in the batch */
+  int next;           /* first puzzle not yet claimed by a thread */
+  int done;           /* puzzles finished by the threads */
+  int generation;     /* incremented each time a new batch is started */
+  int quit;           /* set when the threads should exit */
+  pthread_mutex_t lock;
+  pthread_cond_t work;     /* signalled when a new batch is started */
+  pthread_cond_t finished; /* signalled when done reaches count */
+};
+
+int target = 0;
+/*target is the number of hints to stop at, set by -k, or 0 for minimal.*/
+unsigned long seed = 1;
+/*seed is the seed of the random numbers, set by -r.*/
+struct Batch batch;
+/*batch holds the puzzles currently being made.*/
+struct Output output = {1, 0};
+/*output collects the puzzles written to the standard output stream.*/
+
+/*******************************************************************************
+ * next_random() returns a random number from 0 to n - 1, stepping the
+ * generator's xorshift state. Only the low 32 bits of the state are used,
+ * so the numbers are the same wherever unsigned long is wider.
+ * seed_random() mixes the seed with the puzzle number n to start the state
+ * for that puzzle.
+*******************************************************************************/
+
+int next_random(struct Generator* generator, int n)
+{
+  unsigned long x = generator->random;
+  x ^= (x << 13) & 0xFFFFFFFFUL;
+  x ^= x >> 17;
+  x ^= (x << 5) & 0xFFFFFFFFUL;
+  generator->random = x;
+  return x % n;
+}
+
+void seed_random(struct Generator* generator, long n)
+{
+  unsigned long x = (seed*0x9E3779B1UL + n) & 0xFFFFFFFFUL;
+  x = ((x ^ (x >> 16))*0x45D9F3BUL) & 0xFFFFFFFFUL;
+  x = ((x ^ (x >> 16))*0x45D9F3BUL) & 0xFFFFFFFFUL;
+  x ^= x >> 16;
+  generator->random = x ? x : 1;
+}
+
+/*******************************************************************************
+ * shuffle() puts the n numbers of a in a random order.
+*******************************************************************************/
+
+void shuffle(struct Generator* generator, int* a, int n)
+{
+  int k;
+  for (k = n - 1; k > 0; k--)
+    {
+      int j = next_random(generator, k + 1);
+      int temp = a[k];
+      a[k] = a[j];
+      a[j] = temp;
+    }
+}
+
+/*******************************************************************************
+ * random_order() fills order with 0 to SIZE - 1 arranged as a random order
+ * of the bands (or stacks), and a random order of the lines within each.
+*******************************************************************************/
+
+void random_order(struct Generator* generator, int* order)
+{
+  int band[BOX];
+  int line[BOX];
+  int b;
+  int k;
+  for (b = 0; b < BOX; b++) band[b] = b;
+  shuffle(generator, band, BOX);
+  for (b = 0; b < BOX; b++)
+    {
+      for (k = 0; k < BOX; k++) line[k] = k;
+      shuffle(generator, line, BOX);
+      for (k = 0; k < BOX; k++) order[b*BOX + k] = band[b]*BOX + line[k];
+    }
+}
+
+/*******************************************************************************
+ * random_grid() fills grid with a random complete grid. Returns NO if the
+ * diagonal blocks it chose could not be completed within FILL_NODES nodes,
+ * so that make_puzzle() tries again with new ones. The limit is lifted
+ * again for the uniqueness checks.
+*******************************************************************************/
+
+int random_grid(struct Generator* generator, char* grid)
+{
+  char start[CELLS];
+  int digits[SIZE];
+  int row[SIZE];
+  int col[SIZE];
+  int transpose = next_random(generator, 2);
+  int b;
+  int k;
+
+  memset(start, '.', CELLS);
+  for (b = 0; b < BOX; b++)
+    {
+      for (k = 0; k < SIZE; k++) digits[k] = k;
+      shuffle(generator, digits, SIZE);
+      for (k = 0; k < SIZE; k++)
+        {
+          int i = b*BOX + k/BOX;
+          int j = b*BOX + k%BOX;
+          start[i*SIZE + j] = DIGITS[digits[k]];
+        }
+    }
+  generator->sudoku.node_limit = FILL_NODES;
+  b = load_sudoku(&generator->sudoku, start) && solve(&generator->sudoku);
+  generator->sudoku.node_limit = 0;
+  if (!b) return NO;
+
+  random_order(generator, row);
+  random_order(generator, col);
+  for (b = 0; b < SIZE; b++)
+    {
+      for (k = 0; k < SIZE; k++)
+        {
+          int from = transpose ? col[k]*SIZE + row[b] : row[b]*SIZE + col[k];
+          grid[b*SIZE + k] = generator->sudoku.grid[from];
+        }
+    }
+  return YES;
+}
+
+/*******************************************************************************
+ * unique() returns YES if puzzle has only one solution.
+*******************************************************************************/
+
+int unique(struct Generator* generator, const char* puzzle)
+{
+  generator->checks++;
+  load_sudoku(&generator->sudoku, puzzle);
+  return count_solutions(&generator->sudoku, 2) == 1 ? YES : NO;
+}
+
+/*******************************************************************************
+ * make_puzzle() makes puzzle number n and leaves it in puzzle. Every entry
+ * is tried once in a random order, until the puzzle is down to target hints.
+*******************************************************************************/
+
+void make_puzzle(struct Generator* generator, long n, char* puzzle)
+{
+  int order[CELLS];
+  int hints = CELLS;
+  int k;
+
+  seed_random(generator, n);
+  while (!random_grid(generator, puzzle)) continue;
+  for (k = 0; k < CELLS; k++) order[k] = k;
+  shuffle(generator, order, CELLS);
+  for (k = 0; k < CELLS && hints > target; k++)
+    {
+      char hint = puzzle[order[k]];
+      puzzle[order[k]] = '.';
+      if (unique(generator, puzzle)) hints--;
+      else puzzle[order[k]] = hint;
+    }
+}
+
+/*******************************************************************************
+ * generator_main() is run by every thread. It waits for a batch with a new
+ * generation number, then claims one puzzle at a time from batch.next, each
+ * taking far longer than the lock. When the last puzzle of the batch is done
+ * it wakes up main(). It returns once batch.quit is set.
+*******************************************************************************/
+
+void* generator_main(void* arg)
+{
+  struct Generator* generator = arg;
+  int generation = 0;
+
+  pthread_mutex_lock(&batch.lock);
+  for (;;)
+    {
+      while (!batch.quit && batch.generation == generation)
+        {
+          pthread_cond_wait(&batch.work, &batch.lock);
+        }
+      if (batch.quit) break;
+      generation = batch.generation;
+      while (batch.next < batch.count)
+        {
+          int k = batch.next++;
+          pthread_mutex_unlock(&batch.lock);
+          make_puzzle(generator, batch.first + k, batch.puzzle[k]);
+          pthread_mutex_lock(&batch.lock);
+          if (++batch.done == batch.count) pthread_cond_signal(&batch.finished);
+        }
+    }
+  pthread_mutex_unlock(&batch.lock);
+  return NULL;
+}
+
+/*******************************************************************************
+ * usage() prints the command line options and returns the exit status 1.
+*******************************************************************************/
+
+int usage(const char* name)
+{
+  fprintf(stderr, "usage: %s [-n puzzles] [-k hints] [-t threads] [-r seed] "
+          "[-s]\n", name);
+  return 1;
+}
+
+/*******************************************************************************
+ * main() reads the command line: "-n count" is the number of puzzles to
+ * make (10 by default), "-k hints" stops removing hints once a puzzle has
+ * that many instead of going on until it is minimal, "-t n" makes puzzles
+ * with n threads and "-r seed" chooses the random numbers. "-s" prints the
+ * puzzles made per second, their mean number of hints and the uniqueness
+ * checks used to the standard error stream at the end.
+ *
+ * With one thread, main() makes every batch itself. With more, it hands
+ * each batch to the threads the same way sudoku.c does.
+*******************************************************************************/
+
+int main(int argc, char* argv[])
+{
+  struct Generator* generators;
+  unsigned long start;
+  unsigned long checks = 0;
+  double hints = 0;
+  double seconds;
+  long count = 10;
+  int thread_count = 1;
+  int show_stats = NO;
+  int arg;
+  int k;
+
+  for (arg = 1; arg < argc; arg++)
+    {
+      if (strcmp(argv[arg], "-n") == 0 && arg + 1 < argc)
+        {
+          count = atol(argv[++arg]);
+          if (count < 0) return usage(argv[0]);
+        }
+      else if (strcmp(argv[arg], "-k") == 0 && arg + 1 < argc)
+        {
+          target = atoi(argv[++arg]);
+          if (target < 0 || target > CELLS) return usage(argv[0]);
+        }
+      else if (strcmp(argv[arg], "-t") == 0 && arg + 1 < argc)
+        {
+          thread_count = atoi(argv[++arg]);
+          if (thread_count < 1 || thread_count > MAX_THREADS)
+            {
+              return usage(argv[0]);
+            }
+        }
+      else if (strcmp(argv[arg], "-r") == 0 && arg + 1 < argc)
+        {
+          seed = strtoul(argv[++arg], NULL, 10);
+        }
+      else if (strcmp(argv[arg], "-s") == 0) show_stats = YES;
+      else return usage(argv[0]);
+    }
+
+  generators = calloc(thread_count, sizeof(struct Generator));
+  if (generators == NULL)
+    {
+      fprintf(stderr, "generate: out of memory\n");
+      return 1;
+    }
+  solver_init();
+  pthread_mutex_init(&batch.lock, NULL);
+  pthread_cond_init(&batch.work, NULL);
+  pthread_cond_init(&batch.finished, NULL);
+  if (thread_count > 1)
+    {
+      for (k = 0; k < thread_count; k++)
+        {
+          pthread_create(&generators[k].thread, NULL, generator_main,
+                         &generators[k]);
+        }
+    }
+
+  start = latency_now();
+  for (batch.first = 0; batch.first < count; batch.first += batch.count)
+    {
+      batch.count = count - batch.first < BATCH_SIZE ?
+        count - batch.first : BATCH_SIZE;
+      if (thread_count == 1)
+        {
+          for (k = 0; k < batch.count; k++)
+            {
+              make_puzzle(&generators[0], batch.first + k, batch.puzzle[k]);
+            }
+        }
+      else
+        {
+          pthread_mutex_lock(&batch.lock);
+          batch.next = 0;
+          batch.done = 0;
+          batch.generation++;
+          pthread_cond_broadcast(&batch.work);
+          while (batch.done < batch.count)
+            {
+              pthread_cond_wait(&batch.finished, &batch.lock);
+            }
+          pthread_mutex_unlock(&batch.lock);
+        }
+      for (k = 0; k < batch.count; k++)
+        {
+          int i;
+          for (i = 0; i < CELLS; i++) hints += batch.puzzle[k][i] != '.';
+          output_write(&output, batch.puzzle[k], CELLS);
+          output_write(&output, "\n", 1);
+        }
+    }
+  output_flush(&output);
+  seconds = (latency_now() - start)/1e9;
+
+  if (thread_count > 1)
+    {
+      pthread_mutex_lock(&batch.lock);
+      batch.quit = YES;
+      pthread_cond_broadcast(&batch.work);
+      pthread_mutex_unlock(&batch.lock);
+      for (k = 0; k < thread_count; k++)
+        {
+          pthread_join(generators[k].thread, NULL);
+        }
+    }
+  if (show_stats)
+    {
+      for (k = 0; k < thread_count; k++) checks += generators[k].checks;
+      fprintf(stderr, "puzzles: %ld in %.3f s, %.1f per second\n", count,
+              seconds, seconds > 0 ? count/seconds : 0);
+      fprintf(stderr, "hints: mean %.2f, uniqueness checks: %lu\n",
+              count ? hints/count : 0, checks);
+    }
+  free(generators);
+  return 0;
+}
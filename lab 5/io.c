@@ -0,0 +1,280 @@
+/*******************************************************************************
+ * Joseph Adams
+ *
+ * io.c is a source file implementing the functions found in io.h. These
+ * functions are used to read puzzles from a file and write results with as
+ * little copying and as few library calls as possible.
+ *
+ * A mapped file is never copied: next_line() hands out pointers straight
+ * into the mapping, and the solver reads each puzzle from there. Output is
+ * collected in one large buffer and passed to write() when it is full,
+ * instead of going through stdio one character at a time.
+*******************************************************************************/
+
+
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "io.h"
+#include "solver.h"
+
+
+#define ONES (~0UL/255)
+/*ONES has the value 1 in every byte of an unsigned long.*/
+#define HIGHS (ONES*0x80)
+/*HIGHS has the high bit set in every byte of an unsigned long.*/
+
+
+int map_file(struct MappedFile* file, const char* name)
+{
+  struct stat info;
+  void* data;
+  int fd = open(name, O_RDONLY);
+  if (fd < 0) return -1;
+  if (fstat(fd, &info) < 0)
+    {
+      close(fd);
+      return -1;
+    }
+  file->size = info.st_size;
+  file->pos = 0;
+  file->data = "";
+  if (file->size > 0)
+    {
+      data = mmap(NULL, file->size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data == MAP_FAILED)
+        {
+          close(fd);
+          return -1;
+        }
+      posix_madvise(data, file->size, POSIX_MADV_SEQUENTIAL);
+      file->data = data;
+    }
+  close(fd);
+  return 0;
+}
+
+void unmap_file(struct MappedFile* file)
+{
+  if (file->size > 0) munmap((void*)file->data, file->size);
+  file->data = NULL;
+}
+
+/*******************************************************************************
+ * next_line() uses memchr(), which looks at many bytes at a time, to find
+ * the newline ending the line at file->pos. The last line of the file does
+ * not need a newline.
+*******************************************************************************/
+
+const char* next_line(struct MappedFile* file, int* len)
+{
+  const char* line = file->data + file->pos;
+  const char* end;
+  size_t left = file->size - file->pos;
+  if (left == 0) return NULL;
+  end = memchr(line, '\n', left);
+  if (end == NULL)
+    {
+      *len = left;
+      file->pos = file->size;
+    }
+  else
+    {
+      *len = end - line;
+      file->pos += *len + 1;
+    }
+  return line;
+}
+
+/*******************************************************************************
+ * stream_line() is next_line() for the bytes read so far. A line that has
+ * not got its newline yet is left for stream_read() to complete.
+*******************************************************************************/
+
+const char* stream_line(struct Stream* stream, int* len)
+{
+  const char* line = stream->data + stream->pos;
+  const char* end;
+  size_t left = stream->used - stream->pos;
+  if (left == 0) return NULL;
+  end = memchr(line, '\n', left);
+  if (end == NULL)
+    {
+      if (!stream->ended) return NULL;
+      *len = left;
+      stream->pos = stream->used;
+    }
+  else
+    {
+      *len = end - line;
+      stream->pos += *len + 1;
+    }
+  return line;
+}
+
+/*******************************************************************************
+ * stream_read() moves the unfinished line left at pos to the front of the
+ * buffer, doubling the buffer if that line already fills it, and then
+ * makes one call to read(). That returns as soon as anything arrives, so a
+ * single request is answered without waiting for a buffer full of them.
+ * A signal that interrupts read() ends the stream too, which is how a
+ * daemon being stopped lets go of its client.
+*******************************************************************************/
+
+int stream_read(struct Stream* stream)
+{
+  ssize_t n;
+  if (stream->pos > 0)
+    {
+      memmove(stream->data, stream->data + stream->pos,
+              stream->used - stream->pos);
+      stream->used -= stream->pos;
+      stream->pos = 0;
+    }
+  if (stream->used == stream->size)
+    {
+      size_t size = stream->size ? 2*stream->size : 65536;
+      char* temp = realloc(stream->data, size);
+      if (temp == NULL)
+        {
+          stream->ended = YES;
+          return NO;
+        }
+      stream->data = temp;
+      stream->size = size;
+    }
+  n = read(stream->fd, stream->data + stream->used,
+           stream->size - stream->used);
+  if (n <= 0)
+    {
+      stream->ended = YES;
+      return NO;
+    }
+  stream->used += n;
+  return YES;
+}
+
+void stream_free(struct Stream* stream)
+{
+  free(stream->data);
+  stream->data = NULL;
+  stream->size = 0;
+  stream->used = 0;
+  stream->pos = 0;
+}
+
+/*******************************************************************************
+ * write_all() passes len bytes to write(), calling it again if it only
+ * takes some of them or is interrupted.
+*******************************************************************************/
+
+static void write_all(int fd, const char* bytes, size_t len)
+{
+  while (len > 0)
+    {
+      ssize_t n = write(fd, bytes, len);
+      if (n < 0)
+        {
+          if (errno == EINTR) continue;
+          return;
+        }
+      bytes += n;
+      len -= n;
+    }
+}
+
+void output_write(struct Output* out, const char* bytes, size_t len)
+{
+  if (out->used + len > OUTPUT_SIZE) output_flush(out);
+  if (len > OUTPUT_SIZE) write_all(out->fd, bytes, len);
+  else
+    {
+      memcpy(out->data + out->used, bytes, len);
+      out->used += len;
+    }
+}
+
+void output_flush(struct Output* out)
+{
+  write_all(out->fd, out->data, out->used);
+  out->used = 0;
+}
+
+/*******************************************************************************
+ * in_range() checks every byte of the word x at once. It returns a word
+ * with the high bit set in each byte that is from lo to hi, and every other
+ * bit clear. The bytes of x must all be below 0x80 so adding to one byte
+ * can never carry into the next. Adding 0x80 - lo sets the high bit of a
+ * byte that is at least lo, and adding 0x80 - (hi + 1) sets it in one that
+ * is above hi.
+*******************************************************************************/
+
+static unsigned long in_range(unsigned long x, int lo, int hi)
+{
+  unsigned long at_least_lo = x + ONES*(0x80 - lo);
+  unsigned long above_hi = x + ONES*(0x80 - (hi + 1));
+  return at_least_lo & ~above_hi & HIGHS;
+}
+
+/*******************************************************************************
+ * check_line() looks at sizeof(unsigned long) characters at a time. Each
+ * word is copied out of the line with memcpy(), which compiles to a single
+ * load whatever the alignment of line. A word passes if none of its bytes
+ * have the high bit set and each is either in a range of DIGITS or '.'. The
+ * digits are found with in_range(), and '.' is a byte that is 0 once the
+ * word is XORed with dots; the test for a zero byte adds 0x7F to the low 7
+ * bits, which sets the high bit unless they were all 0. The hints are the
+ * digit bytes, so counting the high bits in digits counts them. The
+ * characters left over at the end are checked one at a time.
+ *
+ * The digits are '1' to '9', then 'A' onwards for larger puzzles, then '0'
+ * as the 36th digit, so at most two ranges are needed.
+*******************************************************************************/
+
+int check_line(const char* line, int len, int min_hints)
+{
+  const unsigned long dots = ONES*'.';
+  int first_lo = SIZE >= 36 ? '0' : '1';
+  int first_hi = '0' + (SIZE < 9 ? SIZE : 9);
+  int second_hi = 'A' + (SIZE > 35 ? 26 : SIZE - 9) - 1;
+  int hint_count = 0;
+  int i = 0;
+
+  if (len != CELLS) return NO;
+  for (; i + (int)sizeof(unsigned long) <= len; i += sizeof(unsigned long))
+    {
+      unsigned long x;
+      unsigned long digits;
+      unsigned long y;
+      unsigned long is_dot;
+      memcpy(&x, line + i, sizeof(unsigned long));
+      if (x & HIGHS) return NO;
+      digits = in_range(x, first_lo, first_hi);
+      if (SIZE > 9) digits |= in_range(x, 'A', second_hi);
+      y = x ^ dots;
+      is_dot = ~(((y & ~HIGHS) + ~HIGHS) | y) & HIGHS;
+      if ((digits | is_dot) != HIGHS) return NO;
+#ifdef __GNUC__
+      hint_count += __builtin_popcountl(digits);
+#else
+      while (digits)
+        {
+          digits &= digits - 1;
+          hint_count++;
+        }
+#endif
+    }
+  for (; i < len; i++)
+    {
+      if (digit_value[(unsigned char)line[i]] >= 0) hint_count++;
+      else if (line[i] != '.') return NO;
+    }
+  return hint_count < min_hints ? NO : YES;
+}
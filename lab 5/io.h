@@ -0,0 +1,80 @@
+/*******************************************************************************
+ * Joseph Adams
+ *
+ * io.h is a header file to be used in the source file sudoku.c
+ *
+ * io.h defines the MappedFile struct, which gives the whole of an input file
+ * as one block of memory, and the Output struct, which collects output in a
+ * large buffer so it can be written with few system calls. The Stream struct
+ * reads lines from a pipe or socket as soon as they arrive, for a client
+ * that waits for each answer before sending more. It also declares
+ * check_line(), which checks the characters of one puzzle line.
+*******************************************************************************/
+
+#ifndef IO_H
+#define IO_H
+
+#include <stddef.h>
+
+#define OUTPUT_SIZE (1 << 20)
+/*OUTPUT_SIZE is the number of bytes collected before they are written.*/
+
+struct MappedFile
+{
+  const char* data; /* contents of the file, NULL if none is open */
+  size_t size;      /* bytes in data */
+  size_t pos;       /* offset of the first byte not yet read */
+};
+
+struct Stream
+{
+  int fd;           /* file descriptor read from */
+  char* data;       /* bytes read and not yet discarded */
+  size_t size;      /* bytes allocated for data */
+  size_t used;      /* bytes of data holding input */
+  size_t pos;       /* offset of the first byte not yet handed out */
+  int ended;        /* set once fd has reached its end */
+};
+
+struct Output
+{
+  int fd;                  /* file descriptor written to */
+  size_t used;             /* bytes waiting in data */
+  char data[OUTPUT_SIZE];
+};
+
+/* Map the file called name into memory for reading.
+ * Return 0, or -1 with errno set if it cannot be opened or mapped. */
+int map_file(struct MappedFile* file, const char* name);
+
+/* Remove the mapping made by map_file(). */
+void unmap_file(struct MappedFile* file);
+
+/* Find the next line of file, without its newline. Set *len to its length
+ * and return it, or return NULL at the end of the file. */
+const char* next_line(struct MappedFile* file, int* len);
+
+/* Find the next whole line already read into stream, without its newline.
+ * Set *len to its length and return it, or return NULL if there is none.
+ * Once the stream has ended, the last line does not need a newline. */
+const char* stream_line(struct Stream* stream, int* len);
+
+/* Throw away the lines already handed out, which are no longer valid, and
+ * wait for more input. Return NO, setting ended, at the end of the input,
+ * on an error, or if there is no memory left. */
+int stream_read(struct Stream* stream);
+
+/* Free the memory of stream. The file descriptor is left open. */
+void stream_free(struct Stream* stream);
+
+/* Add len bytes to out, writing out the buffer first if they do not fit. */
+void output_write(struct Output* out, const char* bytes, size_t len);
+
+/* Write everything waiting in out. */
+void output_flush(struct Output* out);
+
+/* Return YES if the len characters of line are a puzzle of CELLS digits
+ * from DIGITS or '.', with at least min_hints digits, otherwise NO. */
+int check_line(const char* line, int len, int min_hints);
+
+#endif
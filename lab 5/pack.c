@@ -0,0 +1,159 @@
+/*******************************************************************************
+ * Joseph Adams
+ *
+ * pack.c is a source file implementing the functions found in pack.h.
+ * These functions are used to turn puzzles and results into the packed
+ * binary format and back.
+ *
+ * Unpacking never has to check characters: every entry is a small number,
+ * and the only thing that can be wrong with it is being larger than SIZE.
+*******************************************************************************/
+
+
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <string.h>
+#include <unistd.h>
+#include "pack.h"
+
+
+static const char magic[4] = {'S', 'D', 'K', 'P'};
+
+/*******************************************************************************
+ * put_count() and get_count() write and read a count as 8 bytes, least
+ * significant first. Where unsigned long has only 32 bits, the top 4 bytes
+ * are written as 0 and ignored when read.
+*******************************************************************************/
+
+static void put_count(unsigned char* bytes, unsigned long count)
+{
+  int k;
+  for (k = 0; k < 8; k++)
+    {
+      bytes[k] = count & 0xFF;
+      count >>= 8;
+    }
+}
+
+static unsigned long get_count(const unsigned char* bytes)
+{
+  unsigned long count = 0;
+  int k;
+  for (k = 7; k >= 0; k--) count = (count << 8) | bytes[k];
+  return count;
+}
+
+void pack_header(unsigned char* header, int kind, unsigned long count)
+{
+  memcpy(header, magic, 4);
+  header[4] = PACK_VERSION;
+  header[5] = SIZE;
+  header[6] = PACK_BITS;
+  header[7] = kind;
+  put_count(header + 8, count);
+}
+
+int read_pack_header(const unsigned char* header, int* kind,
+                     unsigned long* count)
+{
+  if (memcmp(header, magic, 4) != 0 || header[4] != PACK_VERSION ||
+      header[5] != SIZE || header[6] != PACK_BITS ||
+      (header[7] != PACK_PUZZLES && header[7] != PACK_RESULTS)) return NO;
+  *kind = header[7];
+  *count = get_count(header + 8);
+  return YES;
+}
+
+/*******************************************************************************
+ * put_entry() stores value as entry k of record, which must start as all
+ * zero bits. get_entry() reads it back. An entry covers at most two bytes,
+ * since PACK_BITS is never more than 6.
+*******************************************************************************/
+
+static void put_entry(unsigned char* record, int k, int value)
+{
+  int bit = k*PACK_BITS;
+  int shifted = value << (bit % 8);
+  record[bit/8] |= shifted & 0xFF;
+  if ((bit % 8) + PACK_BITS > 8) record[bit/8 + 1] |= shifted >> 8;
+}
+
+static int get_entry(const unsigned char* record, int k)
+{
+  int bit = k*PACK_BITS;
+  int value = record[bit/8] >> (bit % 8);
+  if ((bit % 8) + PACK_BITS > 8) value |= record[bit/8 + 1] << (8 - bit % 8);
+  return value & ((1 << PACK_BITS) - 1);
+}
+
+void pack_puzzle(const char* line, int len, unsigned char* record)
+{
+  int k;
+  memset(record, 0, PACK_BYTES);
+  for (k = 0; k < CELLS; k++)
+    {
+      int value;
+      if (len != CELLS) value = -1;
+      else if (line[k] == '.') value = 0;
+      else if (digit_value[(unsigned char)line[k]] < 0) value = -1;
+      else value = digit_value[(unsigned char)line[k]] + 1;
+      if (value < 0)
+        {
+          memset(record, 0xFF, PACK_BYTES);
+          return;
+        }
+      put_entry(record, k, value);
+    }
+}
+
+/*******************************************************************************
+ * unpack_puzzle() looks each entry up in entry_char, which holds '.' and
+ * then DIGITS.
+*******************************************************************************/
+
+int unpack_puzzle(const unsigned char* record, char* line)
+{
+  static const char entry_char[] = "." DIGITS;
+  int hints = 0;
+  int k;
+  for (k = 0; k < CELLS; k++)
+    {
+      int value = get_entry(record, k);
+      if (value > SIZE) return -1;
+      hints += value != 0;
+      line[k] = entry_char[value];
+    }
+  return hints;
+}
+
+void pack_result(int result, int found, int at_least, const char* solution,
+                 unsigned char* record)
+{
+  record[0] = result | (at_least ? PACK_AT_LEAST : 0);
+  record[1] = found & 0xFF;
+  record[2] = (found >> 8) & 0xFF;
+  record[3] = (found >> 16) & 0xFF;
+  record[4] = (found >> 24) & 0xFF;
+  if (solution != NULL) pack_puzzle(solution, CELLS, record + 5);
+  else memset(record + 5, 0, PACK_BYTES);
+}
+
+void unpack_result(const unsigned char* record, int* result, int* found,
+                   int* at_least, char* solution)
+{
+  *result = record[0] & ~PACK_AT_LEAST;
+  *at_least = (record[0] & PACK_AT_LEAST) != 0;
+  *found = record[1] | record[2] << 8 | (unsigned long)record[3] << 16 |
+    (unsigned long)record[4] << 24;
+  if (unpack_puzzle(record + 5, solution) < 0) memset(solution, '.', CELLS);
+}
+
+void pack_finish(int fd, unsigned long count)
+{
+  unsigned char bytes[8];
+  put_count(bytes, count);
+  if (lseek(fd, 8, SEEK_SET) != 8) return;
+  if (write(fd, bytes, 8) != 8) return;
+  lseek(fd, 0, SEEK_END);
+}
@@ -0,0 +1,91 @@
+/*******************************************************************************
+ * Joseph Adams
+ *
+ * pack.h is a header file to be used in the source files sudoku.c and
+ * pack.c
+ *
+ * pack.h defines the packed binary format for puzzles and results, which
+ * takes less than half the space of text. A packed file starts with a
+ * header of PACK_HEADER bytes:
+ *
+ * bytes 0-3    the letters "SDKP"
+ * byte 4       PACK_VERSION
+ * byte 5       SIZE of the puzzles
+ * byte 6       PACK_BITS, the bits used for each entry
+ * byte 7       PACK_PUZZLES or PACK_RESULTS
+ * bytes 8-15   the number of records, least significant byte first, or all
+ *              ones if it was not known when the file was written
+ *
+ * Then come the records. A puzzle record holds its CELLS entries packed
+ * into PACK_BYTES bytes, PACK_BITS each, starting from the low bits of the
+ * first byte. An entry is 0 for a blank and 1 to SIZE for a digit; any
+ * larger value marks a record that was not a valid puzzle. Such a record
+ * keeps nothing of the line it was packed from, so sudoku -b and
+ * sudokupack -u show it as a line of '?' characters instead. A result record
+ * is one byte with the result from solver.h, plus PACK_AT_LEAST if the
+ * count stopped at the limit, 4 bytes with the number of solutions counted,
+ * least significant first, and the solution packed like a puzzle, or all
+ * blanks if there is none.
+*******************************************************************************/
+
+#ifndef PACK_H
+#define PACK_H
+
+#include <stddef.h>
+#include "solver.h"
+
+#define PACK_VERSION 1
+#define PACK_HEADER 16
+#define PACK_PUZZLES 0
+#define PACK_RESULTS 1
+/*PACK_PUZZLES and PACK_RESULTS are the kinds of packed file.*/
+#if SIZE < 16
+#define PACK_BITS 4
+#elif SIZE < 32
+#define PACK_BITS 5
+#else
+#define PACK_BITS 6
+#endif
+/*PACK_BITS is the fewest bits holding a blank or any digit.*/
+#define PACK_BYTES ((CELLS*PACK_BITS + 7)/8)
+/*PACK_BYTES is the size of a packed puzzle, 41 bytes for a 9x9 puzzle.*/
+#define PACK_RESULT_BYTES (5 + PACK_BYTES)
+#define PACK_UNKNOWN (~0UL)
+/*PACK_UNKNOWN is the record count of a file whose length was not known.*/
+#define PACK_AT_LEAST 0x80
+/*
+PACK_AT_LEAST is set in the result byte when counting stopped at the limit
+given to sudoku -c, so there may be more solutions than were counted.
+*/
+
+/* Fill in the header of a packed file of kind holding count records. */
+void pack_header(unsigned char* header, int kind, unsigned long count);
+
+/* Read the header of a packed file made for this SIZE. Set *kind and
+ * *count and return YES, or return NO if it is not such a header. */
+int read_pack_header(const unsigned char* header, int* kind,
+                     unsigned long* count);
+
+/* Pack the len characters of line. A line that is not CELLS characters
+ * from DIGITS and '.' is packed as an invalid record. */
+void pack_puzzle(const char* line, int len, unsigned char* record);
+
+/* Unpack record into the CELLS characters of line. Return the number of
+ * hints, or -1 if the record is not a valid puzzle. */
+int unpack_puzzle(const unsigned char* record, char* line);
+
+/* Pack a result, with the solution if it is not NULL. Set at_least if
+ * found reached the count limit. */
+void pack_result(int result, int found, int at_least, const char* solution,
+                 unsigned char* record);
+
+/* Unpack a result record, leaving the solution in solution and setting
+ * *at_least if found reached the count limit. */
+void unpack_result(const unsigned char* record, int* result, int* found,
+                   int* at_least, char* solution);
+
+/* Write count into the header of the packed file open as fd, if it can
+ * seek. The file position is left at the end. */
+void pack_finish(int fd, unsigned long count);
+
+#endif
@@ -0,0 +1,873 @@
+/*******************************************************************************
+ * Joseph Adams
+ *
+ * sat.c is a source file implementing the functions found in sat.h. It
+ * solves a sudoku by encoding it in conjunctive normal form and running a
+ * conflict driven clause learning (CDCL) search on the formula.
+ *
+ * The search assigns variables one at a time, and after each decision sets
+ * every literal the clauses force, using two watched literals per clause
+ * so only the clauses that might have become unit are looked at. When a
+ * clause is left with every literal false, analyze() works back through
+ * the reasons for those literals to the first unique implication point and
+ * learns a clause that would have prevented the conflict. The search then
+ * jumps back to the level where the learnt clause forces its literal.
+ *
+ * Decisions follow VSIDS: each variable has a score that grows when it
+ * takes part in a conflict, and all scores decay, so recent conflicts
+ * count most. The search restarts from scratch after a number of conflicts
+ * given by the Luby sequence, keeping what it learnt, and the learnt
+ * clauses used least are thrown away once there are too many.
+*******************************************************************************/
+
+
+
+#include <stdlib.h>
+#include <string.h>
+#include "sat.h"
+#include "stats.h"
+
+
+#define RESTART_UNIT 100
+/*RESTART_UNIT is the number of conflicts in one step of the Luby sequence.*/
+#define DECAY (1/0.95)
+#define CLAUSE_DECAY (1/0.999)
+/*
+DECAY and CLAUSE_DECAY grow the increments after each conflict, which has
+the same effect as shrinking every older score.
+*/
+#define RESCALE 1e100
+/*Scores above RESCALE are all scaled down before they can overflow.*/
+#define PERMANENT (-1.0)
+/*
+PERMANENT is the score of a clause added by sat_count() to rule out a
+solution, which must never be deleted however little it is used.
+*/
+
+/*******************************************************************************
+ * grow() returns data with room for at least need items of unit bytes,
+ * doubling *size until it fits. Running out of memory in the middle of a
+ * search leaves nothing sensible to do, so the program stops.
+*******************************************************************************/
+
+static void* grow(void* data, int* size, int need, size_t unit)
+{
+  int new_size = *size ? *size : 1024;
+  if (need <= *size) return data;
+  while (new_size < need) new_size *= 2;
+  data = realloc(data, new_size*unit);
+  if (data == NULL)
+    {
+      fprintf(stderr, "sudoku: out of memory\n");
+      exit(1);
+    }
+  *size = new_size;
+  return data;
+}
+
+/*******************************************************************************
+ * add_clause() stores the n literals of lits as a new clause and returns
+ * its number. It does not watch it; see attach().
+*******************************************************************************/
+
+static int add_clause(struct SatSolver* sat, const int* lits, int n)
+{
+  int c = sat->clause_count;
+  if (c == sat->clause_size)
+    {
+      int size = sat->clause_size;
+      sat->start = grow(sat->start, &size, c + 1, sizeof(int));
+      size = sat->clause_size;
+      sat->length = grow(sat->length, &size, c + 1, sizeof(int));
+      size = sat->clause_size;
+      sat->clause_activity = grow(sat->clause_activity, &size, c + 1,
+                                  sizeof(double));
+      sat->clause_size = size;
+    }
+  sat->literal = grow(sat->literal, &sat->literal_size,
+                      sat->literal_count + n, sizeof(int));
+  memcpy(sat->literal + sat->literal_count, lits, n*sizeof(int));
+  sat->start[c] = sat->literal_count;
+  sat->length[c] = n;
+  sat->clause_activity[c] = 0;
+  sat->literal_count += n;
+  sat->clause_count++;
+  return c;
+}
+
+/*******************************************************************************
+ * watch() adds clause c to the watches of lit, which are looked at when lit
+ * becomes false.
+*******************************************************************************/
+
+static void watch(struct SatSolver* sat, int lit, int c, int blocker)
+{
+  struct WatchList* list = &sat->watches[lit];
+  list->watch = grow(list->watch, &list->size, list->count + 1,
+                     sizeof(struct Watch));
+  list->watch[list->count].clause = c;
+  list->watch[list->count].blocker = blocker;
+  list->count++;
+}
+
+/*******************************************************************************
+ * The heap holds the unassigned variables with the highest activity at the
+ * top. heap_up() and heap_down() move the variable at index i until the
+ * heap is in order again.
+*******************************************************************************/
+
+static void heap_up(struct SatSolver* sat, int i)
+{
+  int v = sat->heap[i];
+  while (i > 0 && sat->activity[sat->heap[(i - 1)/2]] < sat->activity[v])
+    {
+      sat->heap[i] = sat->heap[(i - 1)/2];
+      sat->heap_index[sat->heap[i]] = i;
+      i = (i - 1)/2;
+    }
+  sat->heap[i] = v;
+  sat->heap_index[v] = i;
+}
+
+static void heap_down(struct SatSolver* sat, int i)
+{
+  int v = sat->heap[i];
+  for (;;)
+    {
+      int child = 2*i + 1;
+      if (child >= sat->heap_count) break;
+      if (child + 1 < sat->heap_count &&
+          sat->activity[sat->heap[child + 1]] >
+          sat->activity[sat->heap[child]])
+        {
+          child++;
+        }
+      if (sat->activity[sat->heap[child]] <= sat->activity[v]) break;
+      sat->heap[i] = sat->heap[child];
+      sat->heap_index[sat->heap[i]] = i;
+      i = child;
+    }
+  sat->heap[i] = v;
+  sat->heap_index[v] = i;
+}
+
+static void heap_insert(struct SatSolver* sat, int v)
+{
+  if (sat->heap_index[v] >= 0) return;
+  sat->heap[sat->heap_count] = v;
+  heap_up(sat, sat->heap_count++);
+}
+
+static int heap_pop(struct SatSolver* sat)
+{
+  int v = sat->heap[0];
+  sat->heap_index[v] = -1;
+  if (--sat->heap_count > 0)
+    {
+      sat->heap[0] = sat->heap[sat->heap_count];
+      heap_down(sat, 0);
+    }
+  return v;
+}
+
+/*******************************************************************************
+ * bump() raises the score of variable v after it took part in a conflict.
+ * bump_clause() does the same for a learnt clause.
+*******************************************************************************/
+
+static void bump(struct SatSolver* sat, int v)
+{
+  if ((sat->activity[v] += sat->increment) > RESCALE)
+    {
+      int k;
+      for (k = 0; k < sat->variables; k++) sat->activity[k] /= RESCALE;
+      sat->increment /= RESCALE;
+    }
+  if (sat->heap_index[v] >= 0) heap_up(sat, sat->heap_index[v]);
+}
+
+static void bump_clause(struct SatSolver* sat, int c)
+{
+  if (sat->clause_activity[c] == PERMANENT) return;
+  if ((sat->clause_activity[c] += sat->clause_increment) > RESCALE)
+    {
+      int k;
+      for (k = sat->original; k < sat->clause_count; k++)
+        {
+          if (sat->clause_activity[k] != PERMANENT)
+            {
+              sat->clause_activity[k] /= RESCALE;
+            }
+        }
+      sat->clause_increment /= RESCALE;
+    }
+}
+
+/*******************************************************************************
+ * assign() makes lit true at the current decision level, because of clause
+ * reason, or -1 for a decision.
+*******************************************************************************/
+
+static void assign(struct SatSolver* sat, int lit, int reason)
+{
+  int v = lit >> 1;
+  sat->value[lit] = 1;
+  sat->value[lit ^ 1] = -1;
+  sat->level[v] = sat->decision_level;
+  sat->reason[v] = reason;
+  sat->trail[sat->trail_count++] = lit;
+  if (reason >= 0) sat->stats.propagations++;
+}
+
+/*******************************************************************************
+ * backtrack() unassigns every literal above decision level, newest first,
+ * putting the variables back in the heap and saving the value each had, so
+ * a later decision on it tries the same value again.
+*******************************************************************************/
+
+static void backtrack(struct SatSolver* sat, int level)
+{
+  int k;
+  if (sat->decision_level <= level) return;
+  for (k = sat->trail_count - 1; k >= sat->trail_start[level + 1]; k--)
+    {
+      int lit = sat->trail[k];
+      int v = lit >> 1;
+      sat->value[lit] = 0;
+      sat->value[lit ^ 1] = 0;
+      sat->phase[v] = (lit & 1) ? -1 : 1;
+      heap_insert(sat, v);
+    }
+  sat->trail_count = sat->trail_start[level + 1];
+  sat->propagated = sat->trail_count;
+  sat->decision_level = level;
+}
+
+/*******************************************************************************
+ * propagate() sets every literal forced by the assignments on the trail
+ * that have not been propagated yet. The two watched literals of a clause
+ * are kept as its first two. When one becomes false, the clause looks for
+ * another literal that is not false to watch instead; if there is none,
+ * the other watched literal is forced, or the clause is a conflict if that
+ * one is false too. A watch also holds a blocker, a literal of the clause
+ * that was true when the watch was made; if it is still true, the clause
+ * is satisfied and need not be looked at at all. Returns the conflicting
+ * clause, or -1 if there was none. Watches of deleted clauses are dropped
+ * as they are passed.
+*******************************************************************************/
+
+static int propagate(struct SatSolver* sat)
+{
+  while (sat->propagated < sat->trail_count)
+    {
+      int false_lit = sat->trail[sat->propagated++] ^ 1;
+      struct WatchList* list = &sat->watches[false_lit];
+      struct Watch* w = list->watch;
+      int n = list->count;
+      int i;
+      int j;
+      for (i = j = 0; i < n; i++)
+        {
+          int c = w[i].clause;
+          int* lits;
+          int first;
+          int k;
+          if (sat->value[w[i].blocker] == 1)
+            {
+              w[j++] = w[i];
+              continue;
+            }
+          if (sat->length[c] == 0) continue;
+          lits = sat->literal + sat->start[c];
+          if (lits[0] == false_lit)
+            {
+              lits[0] = lits[1];
+              lits[1] = false_lit;
+            }
+          first = lits[0];
+          if (first != w[i].blocker && sat->value[first] == 1)
+            {
+              w[j].clause = c;
+              w[j++].blocker = first;
+              continue;
+            }
+          w[j].clause = c;
+          w[j].blocker = first;
+          for (k = 2; k < sat->length[c]; k++)
+            {
+              if (sat->value[lits[k]] != -1) break;
+            }
+          if (k < sat->length[c])
+            {
+              lits[1] = lits[k];
+              lits[k] = false_lit;
+              watch(sat, lits[1], c, first);
+              continue;
+            }
+          j++;
+          if (sat->value[first] == -1)
+            {
+              for (i++; i < n; i++) w[j++] = w[i];
+              list->count = j;
+              sat->propagated = sat->trail_count;
+              return c;
+            }
+          assign(sat, first, c);
+        }
+      list->count = j;
+    }
+  return -1;
+}
+
+/*******************************************************************************
+ * redundant() returns YES if every other literal of clause c, the reason
+ * for a literal of the clause being learnt, is already in that clause or
+ * was set at level 0. The literal it implied then adds nothing and can be
+ * left out.
+*******************************************************************************/
+
+static int redundant(struct SatSolver* sat, int c)
+{
+  const int* lits = sat->literal + sat->start[c];
+  int k;
+  for (k = 1; k < sat->length[c]; k++)
+    {
+      int v = lits[k] >> 1;
+      if (!sat->seen[v] && sat->level[v] > 0) return NO;
+    }
+  return YES;
+}
+
+/*******************************************************************************
+ * analyze() learns a clause from the conflict in clause c. Starting from
+ * the conflict, it walks back along the trail. Literals of the conflict
+ * level are counted in paths and replaced by the literals of their reason,
+ * until only one is left: the first unique implication point. Literals of
+ * earlier levels go straight into the clause. Every variable met is
+ * bumped. The negation of the implication point becomes learnt[0], the
+ * literal the clause will force; redundant literals are then removed, and
+ * the one with the highest level is moved to learnt[1], since that is the
+ * level to jump back to, which is left in *back. Returns the length of
+ * the clause in learnt[].
+*******************************************************************************/
+
+static int analyze(struct SatSolver* sat, int c, int* back)
+{
+  int paths = 0;
+  int lit = -1;
+  int index = sat->trail_count - 1;
+  int n = 1;
+  int keep;
+  int k;
+
+  do
+    {
+      const int* lits = sat->literal + sat->start[c];
+      if (c >= sat->original) bump_clause(sat, c);
+      for (k = lit == -1 ? 0 : 1; k < sat->length[c]; k++)
+        {
+          int v = lits[k] >> 1;
+          if (sat->seen[v] || sat->level[v] == 0) continue;
+          bump(sat, v);
+          sat->seen[v] = YES;
+          if (sat->level[v] >= sat->decision_level) paths++;
+          else sat->learnt[n++] = lits[k];
+        }
+      while (!sat->seen[sat->trail[index] >> 1]) index--;
+      lit = sat->trail[index--];
+      c = sat->reason[lit >> 1];
+      sat->seen[lit >> 1] = NO;
+      paths--;
+    }
+  while (paths > 0);
+  sat->learnt[0] = lit ^ 1;
+
+  for (keep = k = 1; k < n; k++)
+    {
+      int reason = sat->reason[sat->learnt[k] >> 1];
+      if (reason < 0 || !redundant(sat, reason))
+        {
+          sat->learnt[keep++] = sat->learnt[k];
+        }
+    }
+  for (k = sat->trail_start[1]; k < sat->trail_count; k++)
+    {
+      sat->seen[sat->trail[k] >> 1] = NO;
+    }
+
+  *back = 0;
+  for (k = 1; k < keep; k++)
+    {
+      int level = sat->level[sat->learnt[k] >> 1];
+      if (level > *back)
+        {
+          int temp = sat->learnt[1];
+          sat->learnt[1] = sat->learnt[k];
+          sat->learnt[k] = temp;
+          *back = level;
+        }
+    }
+  return keep;
+}
+
+/*******************************************************************************
+ * reduce() deletes the less active half of the learnt clauses, keeping any
+ * clause that is the reason for a literal on the trail and every clause of
+ * two literals, which are cheap and usually useful. A deleted clause keeps
+ * its literals in sat->literal until the next puzzle; its watches are
+ * dropped by propagate().
+*******************************************************************************/
+
+static void reduce(struct SatSolver* sat)
+{
+  double* scores = malloc((sat->clause_count - sat->original)*sizeof(double));
+  double median;
+  int count = 0;
+  int c;
+
+  if (scores == NULL) return;
+  for (c = sat->original; c < sat->clause_count; c++)
+    {
+      if (sat->length[c] > 2 && sat->clause_activity[c] != PERMANENT)
+        {
+          scores[count++] = sat->clause_activity[c];
+        }
+    }
+  if (count == 0)
+    {
+      free(scores);
+      return;
+    }
+  /* Find the median score with a partial quickselect. */
+  {
+    int lo = 0;
+    int hi = count - 1;
+    int mid = count/2;
+    while (lo < hi)
+      {
+        double pivot = scores[(lo + hi)/2];
+        int i = lo;
+        int j = hi;
+        while (i <= j)
+          {
+            while (scores[i] < pivot) i++;
+            while (scores[j] > pivot) j--;
+            if (i <= j)
+              {
+                double temp = scores[i];
+                scores[i++] = scores[j];
+                scores[j--] = temp;
+              }
+          }
+        if (mid <= j) hi = j;
+        else if (mid >= i) lo = i;
+        else break;
+      }
+    median = scores[mid];
+  }
+  free(scores);
+
+  for (c = sat->original; c < sat->clause_count; c++)
+    {
+      const int* lits = sat->literal + sat->start[c];
+      if (sat->length[c] <= 2 || sat->clause_activity[c] >= median ||
+          sat->clause_activity[c] == PERMANENT) continue;
+      if (sat->value[lits[0]] == 1 && sat->reason[lits[0] >> 1] == c) continue;
+      sat->length[c] = 0;
+      sat->learnt_count--;
+    }
+}
+
+/*******************************************************************************
+ * luby() returns term i of the Luby sequence 1, 1, 2, 1, 1, 2, 4, 1, ...,
+ * which sets how many RESTART_UNITs of conflicts come before each restart.
+*******************************************************************************/
+
+static unsigned long luby(unsigned long i)
+{
+  unsigned long size = 1;
+  unsigned long term = 1;
+  while (size < i + 1)
+    {
+      size = 2*size + 1;
+      term *= 2;
+    }
+  while (size - 1 != i)
+    {
+      size = (size - 1)/2;
+      term /= 2;
+      if (i >= size) i -= size;
+    }
+  return term;
+}
+
+/*******************************************************************************
+ * encode() builds the formula for grid. Every blank entry gets a variable
+ * for each digit not already in its row, column or block, and four sets of
+ * constraints are added for the blank entries: each entry holds at least
+ * one digit, and at most one, and each digit missing from a row, column or
+ * block goes in at least one of its blank entries, and at most one. "At
+ * most one" is a clause of two negated literals for every pair. Both halves
+ * of each rule are not strictly needed, but the extra clauses let
+ * propagate() find far more on its own.
+*******************************************************************************/
+
+static void encode(struct SatSolver* sat, const char* grid)
+{
+  unsigned long row_mask[SIZE];
+  unsigned long col_mask[SIZE];
+  unsigned long box_mask[SIZE];
+  int lits[SIZE];
+  int pair[2];
+  int pos;
+  int u;
+  int d;
+  int a;
+  int b;
+
+  sat->variables = 0;
+  sat->literal_count = 0;
+  sat->clause_count = 0;
+  for (a = 0; a < SIZE; a++)
+    {
+      row_mask[a] = 0;
+      col_mask[a] = 0;
+      box_mask[a] = 0;
+    }
+  for (pos = 0; pos < CELLS; pos++)
+    {
+      if (grid[pos] == '.') continue;
+      d = digit_value[(unsigned char)grid[pos]];
+      row_mask[pos/SIZE] |= 1UL << d;
+      col_mask[pos%SIZE] |= 1UL << d;
+      box_mask[(pos/SIZE/BOX)*BOX + pos%SIZE/BOX] |= 1UL << d;
+    }
+  for (pos = 0; pos < CELLS; pos++)
+    {
+      unsigned long taken = row_mask[pos/SIZE] | col_mask[pos%SIZE] |
+        box_mask[(pos/SIZE/BOX)*BOX + pos%SIZE/BOX];
+      for (d = 0; d < SIZE; d++)
+        {
+          int* variable = &sat->variable[pos*SIZE + d];
+          *variable = -1;
+          if (grid[pos] != '.' || (taken >> d & 1)) continue;
+          sat->choice[sat->variables] = pos*SIZE + d;
+          *variable = sat->variables++;
+        }
+    }
+
+  for (u = 0; u < CELLS + UNITS*SIZE; u++)
+    {
+      int n = 0;
+      if (u < CELLS && grid[u] != '.') continue;
+      if (u >= CELLS)
+        {
+          int unit = (u - CELLS)/SIZE;
+          unsigned long placed;
+          d = (u - CELLS)%SIZE;
+          if (unit < SIZE) placed = row_mask[unit];
+          else if (unit < 2*SIZE) placed = col_mask[unit - SIZE];
+          else placed = box_mask[unit - 2*SIZE];
+          if (placed >> d & 1) continue;
+        }
+      for (a = 0; a < SIZE; a++)
+        {
+          int choice = u*SIZE + a;
+          if (u >= CELLS)
+            {
+              int unit = (u - CELLS)/SIZE;
+              int line = unit%SIZE;
+              if (unit < SIZE) pos = line*SIZE + a;
+              else if (unit < 2*SIZE) pos = a*SIZE + line;
+              else pos = ((line/BOX)*BOX + a/BOX)*SIZE +
+                     (line%BOX)*BOX + a%BOX;
+              choice = pos*SIZE + d;
+            }
+          if (sat->variable[choice] >= 0) lits[n++] = 2*sat->variable[choice];
+        }
+      add_clause(sat, lits, n);
+      for (a = 0; a < n; a++)
+        {
+          for (b = a + 1; b < n; b++)
+            {
+              pair[0] = lits[a] ^ 1;
+              pair[1] = lits[b] ^ 1;
+              add_clause(sat, pair, 2);
+            }
+        }
+    }
+  sat->original = sat->clause_count;
+  sat->learnt_count = 0;
+}
+
+/*******************************************************************************
+ * start() sets up the search of the formula just encoded: every variable
+ * unassigned and in the heap, every clause of two or more literals watched
+ * by its first two, and every clause of one literal made true at level 0.
+ * The scores start from the candidates of each entry, so the first
+ * decisions go to the entries with the fewest, as solve() would choose.
+ * Returns NO if the formula is already false: it has an empty clause or
+ * two units that disagree.
+*******************************************************************************/
+
+static int start(struct SatSolver* sat)
+{
+  int candidates[CELLS];
+  int c;
+  int v;
+  for (v = 0; v < SAT_LITERALS; v++) sat->watches[v].count = 0;
+  sat->trail_count = 0;
+  sat->propagated = 0;
+  sat->decision_level = 0;
+  sat->trail_start[0] = 0;
+  sat->increment = 1;
+  sat->clause_increment = 1;
+  sat->heap_count = 0;
+  for (v = 0; v < sat->variables; v++)
+    {
+      sat->value[2*v] = 0;
+      sat->value[2*v + 1] = 0;
+      sat->phase[v] = -1;
+      sat->seen[v] = NO;
+      sat->reason[v] = -1;
+      sat->heap_index[v] = -1;
+    }
+  for (c = 0; c < CELLS; c++) candidates[c] = 0;
+  for (v = 0; v < sat->variables; v++) candidates[sat->choice[v]/SIZE]++;
+  for (v = 0; v < sat->variables; v++)
+    {
+      sat->activity[v] = 1.0/candidates[sat->choice[v]/SIZE];
+    }
+  for (c = 0; c < sat->original; c++)
+    {
+      const int* lits = sat->literal + sat->start[c];
+      if (sat->length[c] == 0) return NO;
+      if (sat->length[c] == 1)
+        {
+          if (sat->value[lits[0]] == -1) return NO;
+          if (sat->value[lits[0]] == 0) assign(sat, lits[0], -1);
+          continue;
+        }
+      watch(sat, lits[0], c, lits[1]);
+      watch(sat, lits[1], c, lits[0]);
+    }
+  for (v = 0; v < sat->variables; v++) heap_insert(sat, v);
+  return YES;
+}
+
+/*******************************************************************************
+ * learn() adds the clause of n literals in learnt[], after backtrack() has
+ * gone back to the level where all but learnt[0] are false, and makes
+ * learnt[0] true because of it. A clause of one literal is simply set at
+ * level 0, where it stays.
+*******************************************************************************/
+
+static void learn(struct SatSolver* sat, int n)
+{
+  int c;
+  if (n == 1)
+    {
+      assign(sat, sat->learnt[0], -1);
+      return;
+    }
+  c = add_clause(sat, sat->learnt, n);
+  watch(sat, sat->learnt[0], c, sat->learnt[1]);
+  watch(sat, sat->learnt[1], c, sat->learnt[0]);
+  bump_clause(sat, c);
+  sat->learnt_count++;
+  assign(sat, sat->learnt[0], c);
+}
+
+/*******************************************************************************
+ * search() runs the CDCL loop until every variable is assigned without a
+ * conflict, which is a solution, and returns YES. It returns NO if there
+ * is a conflict at level 0, so the formula cannot be satisfied, or if
+ * node_limit or the deadline is passed, in which case timed_out is set.
+ * Each decision counts as a node and each conflict as a backtrack. The
+ * clock is only read every 256 decisions since it costs far more than one.
+ *
+ * A decision takes the unassigned variable with the highest score and
+ * gives it the value it had last time, or false the first time, since
+ * only one of the digits of an entry can be true.
+*******************************************************************************/
+
+static int search(struct SatSolver* sat, unsigned long* restarts,
+                  unsigned long* conflicts, double* max_learnts)
+{
+  for (;;)
+    {
+      int conflict = propagate(sat);
+      if (conflict >= 0)
+        {
+          int back;
+          int n;
+          sat->stats.backtracks++;
+          (*conflicts)++;
+          if (sat->decision_level == 0) return NO;
+          n = analyze(sat, conflict, &back);
+          backtrack(sat, back);
+          learn(sat, n);
+          sat->increment *= DECAY;
+          sat->clause_increment *= CLAUSE_DECAY;
+        }
+      else
+        {
+          int v;
+          if (*conflicts >= RESTART_UNIT*luby(*restarts))
+            {
+              (*restarts)++;
+              *conflicts = 0;
+              *max_learnts *= 1.1;
+              backtrack(sat, 0);
+            }
+          if (sat->learnt_count - sat->trail_count >= *max_learnts)
+            {
+              reduce(sat);
+            }
+          do
+            {
+              if (sat->heap_count == 0) return YES;
+              v = heap_pop(sat);
+            }
+          while (sat->value[2*v] != 0);
+          sat->stats.nodes++;
+          if ((sat->node_limit && sat->stats.nodes > sat->node_limit) ||
+              (sat->deadline && (sat->stats.nodes & 255) == 0 &&
+               latency_now() > sat->deadline))
+            {
+              sat->timed_out = YES;
+              return NO;
+            }
+          sat->trail_start[++sat->decision_level] = sat->trail_count;
+          if (sat->decision_level > sat->stats.max_depth)
+            {
+              sat->stats.max_depth = sat->decision_level;
+            }
+          assign(sat, 2*v + (sat->phase[v] < 0), -1);
+        }
+    }
+}
+
+/*******************************************************************************
+ * sat_count() encodes grid and searches it until it has found limit
+ * solutions or there are no more. After each solution a clause is added
+ * that rules out exactly that solution: it says one of the variables true
+ * in it must be false. Such a clause is added at level 0, leaving out the
+ * literals already false there; if none are left, there are no more
+ * solutions. The first solution is copied into grid, along with the hints.
+ * sat_solve() is simply sat_count() with a limit of 1.
+*******************************************************************************/
+
+int sat_count(struct SatSolver* sat, char* grid, int limit)
+{
+  unsigned long restarts = 0;
+  unsigned long conflicts = 0;
+  double max_learnts;
+  int v;
+
+  sat->limit = limit;
+  sat->count = 0;
+  sat->timed_out = NO;
+  sat->deadline = sat->time_limit ? latency_now() + sat->time_limit : 0;
+  memset(&sat->stats, 0, sizeof(struct SearchStats));
+  encode(sat, grid);
+  max_learnts = sat->original/3 + 1000;
+  if (!start(sat)) return 0;
+
+  while (sat->count < limit && search(sat, &restarts, &conflicts,
+                                      &max_learnts))
+    {
+      int n = 0;
+      if (sat->count++ == 0)
+        {
+          memcpy(sat->first, grid, CELLS);
+          for (v = 0; v < sat->variables; v++)
+            {
+              if (sat->value[2*v] == 1)
+                {
+                  sat->first[sat->choice[v]/SIZE] =
+                    DIGITS[sat->choice[v]%SIZE];
+                }
+            }
+        }
+      for (v = 0; v < sat->variables; v++)
+        {
+          if (sat->value[2*v] == 1 && sat->level[v] > 0)
+            {
+              sat->learnt[n++] = 2*v + 1;
+            }
+        }
+      backtrack(sat, 0);
+      if (n == 0) break;
+      if (n == 1) assign(sat, sat->learnt[0], -1);
+      else
+        {
+          int c = add_clause(sat, sat->learnt, n);
+          sat->clause_activity[c] = PERMANENT;
+          watch(sat, sat->learnt[0], c, sat->learnt[1]);
+          watch(sat, sat->learnt[1], c, sat->learnt[0]);
+        }
+    }
+  if (sat->count > 0) memcpy(grid, sat->first, CELLS);
+  return sat->count;
+}
+
+int sat_solve(struct SatSolver* sat, char* grid)
+{
+  return sat_count(sat, grid, 1) > 0 && !sat->timed_out ? YES : NO;
+}
+
+/*******************************************************************************
+ * sat_export() numbers the variables from 1, as DIMACS does, so variable v
+ * of the solver is v + 1 in the file and its negation -(v + 1).
+*******************************************************************************/
+
+int sat_export(struct SatSolver* sat, const char* grid, FILE* file)
+{
+  int c;
+  int v;
+  encode(sat, grid);
+  fprintf(file, "c sudoku %dx%d\n", SIZE, SIZE);
+  fprintf(file, "c %s\n", "variable row column digit");
+  for (v = 0; v < sat->variables; v++)
+    {
+      int pos = sat->choice[v]/SIZE;
+      fprintf(file, "c %d %d %d %c\n", v + 1, pos/SIZE + 1, pos%SIZE + 1,
+              DIGITS[sat->choice[v]%SIZE]);
+    }
+  fprintf(file, "p cnf %d %d\n", sat->variables, sat->clause_count);
+  for (c = 0; c < sat->clause_count; c++)
+    {
+      const int* lits = sat->literal + sat->start[c];
+      int k;
+      for (k = 0; k < sat->length[c]; k++)
+        {
+          fprintf(file, "%d ", (lits[k] & 1) ? -(lits[k]/2 + 1)
+                  : lits[k]/2 + 1);
+        }
+      fprintf(file, "0\n");
+    }
+  return ferror(file) ? NO : YES;
+}
+
+void sat_free(struct SatSolver* sat)
+{
+  int k;
+  for (k = 0; k < SAT_LITERALS; k++)
+    {
+      free(sat->watches[k].watch);
+      sat->watches[k].watch = NULL;
+      sat->watches[k].size = 0;
+      sat->watches[k].count = 0;
+    }
+  free(sat->literal);
+  free(sat->start);
+  free(sat->length);
+  free(sat->clause_activity);
+  sat->literal = NULL;
+  sat->start = NULL;
+  sat->length = NULL;
+  sat->clause_activity = NULL;
+  sat->literal_size = 0;
+  sat->clause_size = 0;
+}
@@ -0,0 +1,112 @@
+/*******************************************************************************
+ * Joseph Adams
+ *
+ * sat.h is a header file to be used in the source file sudoku.c
+ *
+ * sat.h defines the SatSolver struct, which holds a sudoku encoded as a
+ * formula in conjunctive normal form, along with sat_solve() and
+ * sat_count(), which solve it with a conflict driven clause learning SAT
+ * engine, and sat_export(), which writes the formula in the DIMACS format
+ * read by other SAT solvers. For grids of 36x36 and up, where backtracking
+ * on entries can wander for hours, learning from each dead end pays for
+ * itself many times over.
+ *
+ * There is one variable for each digit still possible at each blank entry,
+ * meaning "this entry holds this digit". The clauses say that every entry
+ * holds exactly one digit and that every row, column and block holds every
+ * missing digit exactly once. The hints are not variables at all; the
+ * digits they rule out are simply left out of the formula.
+*******************************************************************************/
+
+#ifndef SAT_H
+#define SAT_H
+
+#include <stdio.h>
+#include "solver.h"
+
+#define SAT_VARIABLES (CELLS*SIZE)
+/*SAT_VARIABLES is the most variables a puzzle can need.*/
+#define SAT_LITERALS (2*SAT_VARIABLES)
+/*
+A literal is a variable or its negation: literal 2*v is variable v and
+literal 2*v + 1 its negation, so the negation of literal l is l ^ 1.
+*/
+
+struct Watch
+{
+  int clause;  /* clause watching the literal */
+  int blocker; /* another literal of it; if true the clause is satisfied */
+};
+
+struct WatchList
+{
+  struct Watch* watch;
+  int count;
+  int size;
+};
+
+struct SatSolver
+{
+  int variables;            /* variables in the formula */
+  int variable[CELLS*SIZE]; /* variable of pos*SIZE + digit, or -1 */
+  int choice[SAT_VARIABLES]; /* pos*SIZE + digit of each variable */
+  int* literal;             /* literals of every clause, one after another */
+  int literal_count;        /* literals in use */
+  int literal_size;         /* literals allocated */
+  int* start;               /* index in literal of each clause */
+  int* length;              /* literals in each clause, 0 once deleted */
+  double* clause_activity;  /* how recently each learnt clause was used */
+  int clause_count;         /* clauses in use */
+  int clause_size;          /* clauses allocated */
+  int original;             /* clauses of the encoding, before any learnt */
+  int learnt_count;         /* learnt clauses not deleted */
+  struct WatchList watches[SAT_LITERALS]; /* clauses watching each literal */
+  signed char value[SAT_LITERALS]; /* 1 true, -1 false, 0 unassigned */
+  int level[SAT_VARIABLES];  /* decision level each variable was set at */
+  int reason[SAT_VARIABLES]; /* clause that implied it, -1 for a decision */
+  int trail[SAT_VARIABLES];  /* assigned literals, in order */
+  int trail_count;
+  int trail_start[SAT_VARIABLES + 1]; /* trail index of each level */
+  int decision_level;
+  int propagated;            /* trail entries already propagated */
+  double activity[SAT_VARIABLES]; /* VSIDS score of each variable */
+  double increment;          /* amount added to a score by a conflict */
+  double clause_increment;   /* the same for learnt clauses */
+  int heap[SAT_VARIABLES];   /* unassigned variables, highest score first */
+  int heap_index[SAT_VARIABLES]; /* place of each variable in heap, or -1 */
+  int heap_count;
+  signed char phase[SAT_VARIABLES]; /* last value of each variable */
+  char seen[SAT_VARIABLES];  /* marks used by analyze() */
+  int learnt[SAT_VARIABLES]; /* the clause being learnt */
+  int limit;                 /* stop searching once count reaches this */
+  int count;                 /* solutions found so far */
+  char first[CELLS];         /* the first solution found */
+  struct SearchStats stats;  /* decisions, conflicts and implied literals */
+  unsigned long node_limit;  /* most decisions a search may use, 0 for none */
+  unsigned long time_limit;  /* most ns a search may take, 0 for no limit */
+  unsigned long deadline;    /* clock reading time_limit after the start */
+  int timed_out;             /* set if the last search hit a limit */
+};
+
+/* Solve the CELLS character puzzle in grid, using '.' for blanks.
+ * The hints must already be known to be legal. Fill in the blanks and
+ * return YES if there is a solution, otherwise leave grid unchanged and
+ * return NO. */
+int sat_solve(struct SatSolver* sat, char* grid);
+
+/* Count the solutions of grid, stopping once limit have been found.
+ * Return the number found and copy the first one into grid.
+ * Both functions give up and set timed_out if node_limit or time_limit
+ * is reached. */
+int sat_count(struct SatSolver* sat, char* grid, int limit);
+
+/* Write the formula for grid to file in DIMACS format, with a comment
+ * line giving the entry and digit of each variable. If the hints leave
+ * some entry or unit with no possible digit, the formula holds an empty
+ * clause. Return NO if writing failed. */
+int sat_export(struct SatSolver* sat, const char* grid, FILE* file);
+
+/* Free the clauses and watch lists held by sat. */
+void sat_free(struct SatSolver* sat);
+
+#endif
@@ -0,0 +1,656 @@
+/*******************************************************************************
+ * Joseph Adams
+ *
+ * solver.c is a source file implementing the functions found in solver.h.
+ * These functions are used to load a sudoku puzzle and solve it by
+ * constraint propagation and backtracking search.
+ *
+ * The candidates of each entry are never searched for in the grid. Instead
+ * the Sudoku struct keeps row_mask[], col_mask[] and box_mask[], which hold
+ * one bit per digit already placed in each row, column and square block, and
+ * cand[], which holds one bit per digit still possible at each blank entry.
+ * Bit 0 stands for the first character of DIGITS, '1', and so on. Placing a
+ * digit clears its bit from the candidates of the PEERS entries that share a
+ * row, column or block (20 of them in a 9x9 puzzle).
+ *
+ * Candidate masks are handled as unsigned long in the functions below, so
+ * the same code works for every mask_t, and stored as mask_t in the struct
+ * so that a Sudoku and its trail stay small and cache friendly.
+*******************************************************************************/
+
+
+
+#include <string.h>
+#include "solver.h"
+#include "stats.h"
+
+
+int digit_value[256];
+int unit_cells[UNITS][SIZE];
+/*
+unit_cells[] lists the positions in each row (units 0 to SIZE - 1), column
+(units SIZE to 2*SIZE - 1) and square block (the last SIZE units).
+*/
+int peers[CELLS][PEERS];
+/*peers[] lists the other positions sharing a row, column or block.*/
+int box_of[CELLS];
+/*box_of[] is the number of the square block holding each position.*/
+
+/*******************************************************************************
+ * bit_count() returns the number of set bits in the candidate mask x. When
+ * compiled with gcc it uses the builtin, which becomes a single popcnt
+ * instruction where the processor has one. Otherwise it clears the lowest
+ * set bit until none are left.
+*******************************************************************************/
+
+static int bit_count(unsigned long x)
+{
+#ifdef __GNUC__
+  return __builtin_popcountl(x);
+#else
+  int n = 0;
+  while (x)
+    {
+      x &= x - 1;
+      n++;
+    }
+  return n;
+#endif
+}
+
+/*******************************************************************************
+ * digit_bit() returns the mask bit of the digit character n.
+*******************************************************************************/
+
+static unsigned long digit_bit(char n)
+{
+  return 1UL << digit_value[(unsigned char)n];
+}
+
+/*******************************************************************************
+ * solver_init() fills in digit_value[], unit_cells[], peers[] and box_of[].
+ * The peers of a position are collected from the three units it belongs to,
+ * skipping the position itself and the block entries already listed by its
+ * row or column.
+*******************************************************************************/
+
+void solver_init(void)
+{
+  int pos;
+  int k;
+  for(k = 0; k < 256; k++) digit_value[k] = -1;
+  for(k = 0; k < SIZE; k++) digit_value[(unsigned char)DIGITS[k]] = k;
+  for(k = 0; k < SIZE; k++)
+    {
+      int m;
+      for(m = 0; m < SIZE; m++)
+        {
+          unit_cells[k][m] = k*SIZE + m;
+          unit_cells[SIZE + k][m] = m*SIZE + k;
+          unit_cells[2*SIZE + k][m] = ((k/BOX)*BOX + m/BOX)*SIZE +
+            (k%BOX)*BOX + m%BOX;
+        }
+    }
+  for(pos = 0; pos < CELLS; pos++)
+    {
+      int i = pos/SIZE;
+      int j = pos%SIZE;
+      int count = 0;
+      box_of[pos] = (i/BOX)*BOX + j/BOX;
+      for(k = 0; k < SIZE; k++)
+        {
+          int box_pos = unit_cells[2*SIZE + box_of[pos]][k];
+          if(k != j) peers[pos][count++] = i*SIZE + k;
+          if(k != i) peers[pos][count++] = k*SIZE + j;
+          if(box_pos/SIZE != i && box_pos%SIZE != j)
+            {
+              peers[pos][count++] = box_pos;
+            }
+        }
+    }
+}
+
+/*******************************************************************************
+ * record() adds a change to the trail before it is made. Every change to a
+ * Sudoku after load_sudoku() goes through eliminate() or assign(), which
+ * both record it, so undo() can always put things back the way they were.
+*******************************************************************************/
+
+static void record(struct Sudoku* sudoku, int pos, unsigned long old)
+{
+  struct Change* change = &sudoku->trail[sudoku->trail_count++];
+  change->pos = pos;
+  change->old = old;
+}
+
+/*******************************************************************************
+ * eliminate() removes the digits in bits from the candidates of the blank
+ * entry at pos. It returns NO if that leaves the entry with no candidates.
+ * If it leaves exactly one, the entry is added to the queue of naked singles
+ * so propagate() will place it. *changed is set if anything was removed.
+*******************************************************************************/
+
+static int eliminate(struct Sudoku* sudoku, int pos, unsigned long bits,
+                     int* changed)
+{
+  unsigned long cand = sudoku->cand[pos];
+  if(sudoku->grid[pos] != '.' || !(cand & bits)) return YES;
+  record(sudoku, pos, cand);
+  cand &= ~bits;
+  sudoku->cand[pos] = cand;
+  *changed = YES;
+  if(cand == 0) return NO;
+  if(!(cand & (cand - 1))) sudoku->queue[sudoku->queue_count++] = pos;
+  return YES;
+}
+
+/*******************************************************************************
+ * assign() places the digit with mask bit at the blank entry pos. It marks
+ * the digit in the masks of the row, column and block, removes pos from
+ * empty[] by swapping the last blank entry into its slot, and clears the
+ * digit from the candidates of every peer. It returns NO if a peer is left
+ * with no candidates, which means the placement is impossible.
+*******************************************************************************/
+
+static int assign(struct Sudoku* sudoku, int pos, unsigned long bit)
+{
+  int last;
+  int changed;
+  int k;
+
+  record(sudoku, -1 - pos, sudoku->cand[pos]);
+  sudoku->grid[pos] = DIGITS[bit_count(bit - 1)];
+  sudoku->row_mask[pos/SIZE] |= bit;
+  sudoku->col_mask[pos%SIZE] |= bit;
+  sudoku->box_mask[box_of[pos]] |= bit;
+  sudoku->cand[pos] = bit;
+  last = sudoku->empty[--sudoku->empty_count];
+  sudoku->empty[sudoku->slot[pos]] = last;
+  sudoku->slot[last] = sudoku->slot[pos];
+  for(k = 0; k < PEERS; k++)
+    {
+      if(!eliminate(sudoku, peers[pos][k], bit, &changed)) return NO;
+    }
+  return YES;
+}
+
+/*******************************************************************************
+ * undo() takes changes off the trail, newest first, and reverses them until
+ * only mark changes are left. A placed digit is reversed by clearing it from
+ * the masks and putting pos back in empty[]; assign() moved the entry that
+ * was last in empty[] into the slot of pos, so that entry is moved back to
+ * the end. Anything left in the queue was found after the point being
+ * returned to, and is thrown away.
+*******************************************************************************/
+
+static void undo(struct Sudoku* sudoku, int mark)
+{
+  while(sudoku->trail_count > mark)
+    {
+      struct Change* change = &sudoku->trail[--sudoku->trail_count];
+      if(change->pos >= 0) sudoku->cand[change->pos] = change->old;
+      else
+        {
+          int pos = -1 - change->pos;
+          int slot = sudoku->slot[pos];
+          int moved = sudoku->empty[slot];
+          unsigned long bit = sudoku->cand[pos];
+          sudoku->grid[pos] = '.';
+          sudoku->row_mask[pos/SIZE] &= ~bit;
+          sudoku->col_mask[pos%SIZE] &= ~bit;
+          sudoku->box_mask[box_of[pos]] &= ~bit;
+          sudoku->cand[pos] = change->old;
+          sudoku->empty[sudoku->empty_count] = moved;
+          sudoku->slot[moved] = sudoku->empty_count;
+          sudoku->empty[slot] = pos;
+          sudoku->empty_count++;
+        }
+    }
+  sudoku->queue_count = 0;
+}
+
+/*******************************************************************************
+ * naked_singles() places every entry in the queue, which are the blank
+ * entries left with a single candidate. Placing one can put more entries in
+ * the queue, so it keeps going until the queue is empty.
+*******************************************************************************/
+
+static int naked_singles(struct Sudoku* sudoku, int* changed)
+{
+  while(sudoku->queue_count > 0)
+    {
+      int pos = sudoku->queue[--sudoku->queue_count];
+      if(sudoku->grid[pos] != '.') continue;
+      *changed = YES;
+      sudoku->stats.propagations++;
+      if(!assign(sudoku, pos, sudoku->cand[pos])) return NO;
+    }
+  return YES;
+}
+
+/*******************************************************************************
+ * hidden_singles() looks for digits that fit in only one entry of a row,
+ * column or block. For each unit it builds once, the digits possible in at
+ * least one blank entry, and twice, those possible in at least two. A digit
+ * that is neither placed in the unit nor in once cannot go anywhere, so NO
+ * is returned. The digits in once but not twice are hidden singles, and each
+ * is placed at the one entry that holds it.
+*******************************************************************************/
+
+static int hidden_singles(struct Sudoku* sudoku, int* changed)
+{
+  int u;
+  for(u = 0; u < UNITS; u++)
+    {
+      unsigned long once = 0;
+      unsigned long twice = 0;
+      unsigned long placed;
+      unsigned long single;
+      int k;
+      for(k = 0; k < SIZE; k++)
+        {
+          int pos = unit_cells[u][k];
+          if(sudoku->grid[pos] == '.')
+            {
+              twice |= once & sudoku->cand[pos];
+              once |= sudoku->cand[pos];
+            }
+        }
+      if(u < SIZE) placed = sudoku->row_mask[u];
+      else if(u < 2*SIZE) placed = sudoku->col_mask[u - SIZE];
+      else placed = sudoku->box_mask[u - 2*SIZE];
+      if((once | placed) != ALL_DIGITS) return NO;
+      single = once & ~twice;
+      while(single)
+        {
+          unsigned long bit = single & -single;
+          single ^= bit;
+          for(k = 0; k < SIZE; k++)
+            {
+              int pos = unit_cells[u][k];
+              if(sudoku->grid[pos] == '.' && (sudoku->cand[pos] & bit))
+                {
+                  *changed = YES;
+                  sudoku->stats.propagations++;
+                  if(!assign(sudoku, pos, bit)) return NO;
+                  break;
+                }
+            }
+        }
+    }
+  return YES;
+}
+
+/*******************************************************************************
+ * locked_candidates() looks at the BOX entries where each row or column
+ * crosses each block. seg[] holds the candidates of those segments, first
+ * for the rows and then for the columns; segment s of line l sits in the
+ * s'th block along it. For each segment, in_block is the union of the
+ * other segments of its block and in_line that of the other segments of its
+ * line.
+ *
+ * If a digit is possible in only one segment of a block, it must go in that
+ * segment, so it is removed from the rest of the segment's row or column
+ * (pointing). If a digit is possible in only one segment of a row or column,
+ * it is removed from the rest of that segment's block (claiming).
+*******************************************************************************/
+
+static int locked_candidates(struct Sudoku* sudoku, int* changed)
+{
+  unsigned long seg[2][SIZE][BOX];
+  int dir;
+  int line;
+  int s;
+  int k;
+
+  for(dir = 0; dir < 2; dir++)
+    {
+      for(line = 0; line < SIZE; line++)
+        {
+          for(s = 0; s < BOX; s++)
+            {
+              unsigned long mask = 0;
+              for(k = 0; k < BOX; k++)
+                {
+                  int pos = dir == 0 ? line*SIZE + s*BOX + k
+                                     : (s*BOX + k)*SIZE + line;
+                  if(sudoku->grid[pos] == '.') mask |= sudoku->cand[pos];
+                }
+              seg[dir][line][s] = mask;
+            }
+        }
+    }
+
+  for(dir = 0; dir < 2; dir++)
+    {
+      for(line = 0; line < SIZE; line++)
+        {
+          int first = (line/BOX)*BOX;
+          int band = line%BOX;
+          for(s = 0; s < BOX; s++)
+            {
+              unsigned long in_block = 0;
+              unsigned long in_line = 0;
+              unsigned long pointing;
+              unsigned long claiming;
+              for(k = 0; k < BOX; k++)
+                {
+                  if(k != band) in_block |= seg[dir][first + k][s];
+                  if(k != s) in_line |= seg[dir][line][k];
+                }
+              pointing = seg[dir][line][s] & ~in_block;
+              claiming = seg[dir][line][s] & ~in_line;
+              if(!pointing && !claiming) continue;
+              for(k = 0; k < SIZE; k++)
+                {
+                  int pos = dir == 0 ? line*SIZE + k : k*SIZE + line;
+                  int box_pos = dir == 0
+                    ? (first + k/BOX)*SIZE + s*BOX + k%BOX
+                    : (s*BOX + k%BOX)*SIZE + first + k/BOX;
+                  if(pointing && k/BOX != s &&
+                     !eliminate(sudoku, pos, pointing, changed)) return NO;
+                  if(claiming && k/BOX != band &&
+                     !eliminate(sudoku, box_pos, claiming, changed)) return NO;
+                }
+            }
+        }
+    }
+  return YES;
+}
+
+/*******************************************************************************
+ * propagate() applies the rules above until none of them changes anything.
+ * The cheap rules are always tried first: naked singles, then hidden singles,
+ * and locked candidates only once both have stalled. It returns NO as soon
+ * as any rule finds a contradiction.
+*******************************************************************************/
+
+static int propagate(struct Sudoku* sudoku)
+{
+  int changed = YES;
+  while(changed && sudoku->empty_count > 0)
+    {
+      changed = NO;
+      if(!naked_singles(sudoku, &changed)) return NO;
+      if(!hidden_singles(sudoku, &changed)) return NO;
+      if(changed) continue;
+      if(!locked_candidates(sudoku, &changed)) return NO;
+    }
+  return naked_singles(sudoku, &changed);
+}
+
+/*******************************************************************************
+ * load_sudoku() creates our puzzle by loading the entries of puzzle into
+ * sudoku->grid using the iteration variable i. Blank entries are added to
+ * empty[]. Every other entry is checked against the masks before it is
+ * added to them, which finds any hint that repeats a digit already in its
+ * row, column or square block. If one does, NO is returned. Once all hints
+ * are in, the candidates of each blank entry are the digits missing from
+ * the masks of its row, column and block.
+*******************************************************************************/
+
+int load_sudoku(struct Sudoku* sudoku, const char* puzzle)
+{
+  int i;
+  int legal = YES;
+  for(i = 0; i < SIZE; i++)
+    {
+      sudoku->row_mask[i] = 0;
+      sudoku->col_mask[i] = 0;
+      sudoku->box_mask[i] = 0;
+    }
+  sudoku->empty_count = 0;
+  sudoku->queue_count = 0;
+  sudoku->trail_count = 0;
+  sudoku->timed_out = NO;
+  sudoku->stats.nodes = 0;
+  sudoku->stats.backtracks = 0;
+  sudoku->stats.propagations = 0;
+  sudoku->stats.max_depth = 0;
+  for(i = 0; i < CELLS; i++)
+    {
+      int box = box_of[i];
+      unsigned long bit;
+      sudoku->grid[i] = puzzle[i];
+      if(puzzle[i] == '.')
+        {
+          sudoku->slot[i] = sudoku->empty_count;
+          sudoku->empty[sudoku->empty_count++] = i;
+          continue;
+        }
+      bit = digit_bit(puzzle[i]);
+      if((sudoku->row_mask[i/SIZE] | sudoku->col_mask[i%SIZE] |
+          sudoku->box_mask[box]) & bit) legal = NO;
+      else
+        {
+          sudoku->row_mask[i/SIZE] |= bit;
+          sudoku->col_mask[i%SIZE] |= bit;
+          sudoku->box_mask[box] |= bit;
+        }
+    }
+  for(i = 0; i < sudoku->empty_count; i++)
+    {
+      int pos = sudoku->empty[i];
+      unsigned long cand = ALL_DIGITS & ~(sudoku->row_mask[pos/SIZE] |
+        sudoku->col_mask[pos%SIZE] | sudoku->box_mask[box_of[pos]]);
+      sudoku->cand[pos] = cand;
+      if(cand && !(cand & (cand - 1)))
+        {
+          sudoku->queue[sudoku->queue_count++] = pos;
+        }
+    }
+  return legal;
+}
+
+/*******************************************************************************
+ * no_solution_check() is a preliminary check used to make sure that every
+ * blank entry in our puzzle has at least one candidate. It walks the list of
+ * blank entries in empty[] and returns YES as soon as it finds one whose
+ * candidate mask is empty.
+*******************************************************************************/
+
+int no_solution_check(struct Sudoku* sudoku)
+{
+  int k;
+  for (k = 0; k < sudoku->empty_count; k++)
+    {
+      if (sudoku->cand[sudoku->empty[k]] == 0) return YES;
+    }
+  return NO;
+}
+
+/*******************************************************************************
+ * solved_check() is used to check if a legal puzzle is solved. Since every
+ * blank entry is kept in empty[], the puzzle is solved exactly when there
+ * are no blank entries left.
+*******************************************************************************/
+
+int solved_check(struct Sudoku* sudoku)
+{
+  return sudoku->empty_count == 0 ? YES : NO;
+}
+
+/*******************************************************************************
+ * search() does the work of both solve() and count_solutions(). It adds each
+ * solution it finds to *count, copies the first one into first (unless first
+ * is NULL), and returns YES as soon as *count reaches limit. It returns NO
+ * if it ran out of possibilities first.
+ *
+ * search() does not call itself. The guesses it is inside of are kept in
+ * sudoku->guesses[], with depth of them in use, and every change made since
+ * a guess is on the trail after its mark. So going back to a guess is just
+ * undo() down to its mark, and no grid is ever copied. This also means a
+ * deep search of a large grid cannot overflow the call stack.
+ *
+ * First it calls propagate(), which places every digit that can be deduced.
+ * Most puzzles are solved right there. Each time around the loop, ok says
+ * whether the last propagate() succeeded. If it did and there are no blank
+ * entries, that is a solution. If it did and there are, propagation has
+ * stalled and a new guess is pushed: it walks the blank entries in empty[]
+ * and counts the candidates of each one with bit_count(), to find the entry
+ * with the fewest legal possibilities. An entry with two candidates cannot
+ * be beaten, since propagation has already placed every single, so the scan
+ * stops there.
+ *
+ * Then the newest guess moves on to its next candidate. It undoes whatever
+ * the last candidate did, takes the next one from remaining, and places it
+ * with assign() and propagate(). A guess with no candidates left is popped,
+ * and the one before it moves on instead. When there are none left, every
+ * possibility has been tried. A search that stops at the limit leaves the
+ * last solution found in sudoku.
+ *
+ * Before each new node it checks sudoku->node_limit, and every 256 nodes
+ * it checks the clock against the deadline worked out from time_limit when
+ * the search began. Reading the clock costs far more than a node, which is
+ * why it is not done every time. If either limit is passed, timed_out is
+ * set and NO is returned.
+ *
+ * If sudoku->share is set, it is called there too, with the guesses in
+ * effect. It may take candidates out of their remaining masks to be
+ * searched elsewhere, and returns YES when the search should give up, in
+ * which case NO is returned without setting timed_out.
+*******************************************************************************/
+
+static int search(struct Sudoku* sudoku, int limit, int* count, char* first)
+{
+  unsigned long deadline = 0;
+  int depth = 0;
+  int ok;
+
+  if (sudoku->time_limit) deadline = latency_now() + sudoku->time_limit;
+  sudoku->stats.nodes++;
+  ok = propagate(sudoku);
+  for (;;)
+    {
+      if (ok && sudoku->empty_count == 0)
+        {
+          if (*count == 0 && first != NULL) memcpy(first, sudoku->grid, CELLS);
+          (*count)++;
+          if (*count >= limit) return YES;
+          ok = NO;
+        }
+      if (ok)
+        {
+          struct Guess* guess = &sudoku->guesses[depth++];
+          int best_count = SIZE + 1;
+          int k;
+          for (k = 0; k < sudoku->empty_count; k++)
+            {
+              int pos = sudoku->empty[k];
+              int count = bit_count(sudoku->cand[pos]);
+              if (count < best_count)
+                {
+                  best_count = count;
+                  guess->pos = pos;
+                  if (count == 2) break;
+                }
+            }
+          guess->remaining = sudoku->cand[guess->pos];
+          guess->mark = sudoku->trail_count;
+          if (depth > sudoku->stats.max_depth) sudoku->stats.max_depth = depth;
+        }
+      else if (depth > 0) sudoku->stats.backtracks++;
+
+      for (;;)
+        {
+          struct Guess* guess;
+          unsigned long remaining;
+          unsigned long bit;
+          if (depth == 0) return NO;
+          guess = &sudoku->guesses[depth - 1];
+          undo(sudoku, guess->mark);
+          remaining = guess->remaining;
+          if (remaining == 0)
+            {
+              depth--;
+              continue;
+            }
+          bit = remaining & -remaining;
+          guess->remaining = remaining ^ bit;
+          sudoku->stats.nodes++;
+          if ((sudoku->node_limit &&
+               sudoku->stats.nodes > sudoku->node_limit) ||
+              (deadline && (sudoku->stats.nodes & 255) == 0 &&
+               latency_now() > deadline))
+            {
+              sudoku->timed_out = YES;
+              return NO;
+            }
+          if (sudoku->share != NULL && sudoku->share(sudoku, depth)) return NO;
+          ok = assign(sudoku, guess->pos, bit) && propagate(sudoku);
+          break;
+        }
+    }
+}
+
+/*******************************************************************************
+ * solve() fills in the puzzle by searching for its first solution. It
+ * returns YES once the puzzle is solved and NO if it cannot be completed.
+*******************************************************************************/
+
+int solve(struct Sudoku* sudoku)
+{
+  int count = 0;
+  return search(sudoku, 1, &count, NULL);
+}
+
+/*******************************************************************************
+ * count_solutions() searches for solutions until it has found limit of them
+ * or there are no more, and returns how many it found. Any solution after
+ * the first one only has to be counted, so a limit of 2 is all it takes to
+ * prove a puzzle unique. The first solution is left in sudoku->grid.
+*******************************************************************************/
+
+int count_solutions(struct Sudoku* sudoku, int limit)
+{
+  char first[CELLS];
+  int count = 0;
+  search(sudoku, limit, &count, first);
+  if (count > 0) memcpy(sudoku->grid, first, CELLS);
+  return count;
+}
+
+/*******************************************************************************
+ * branch_grid() rebuilds the grid as it was when guess number level was
+ * made. Every digit placed since then is on the trail after the mark of the
+ * guess, so those entries are simply blanked in a copy of the grid. The
+ * candidates removed since then are not needed, since load_sudoku() and
+ * propagate() will work them out again from the digits.
+*******************************************************************************/
+
+void branch_grid(const struct Sudoku* sudoku, int level, char* grid)
+{
+  int k;
+  memcpy(grid, sudoku->grid, CELLS);
+  for (k = sudoku->guesses[level].mark; k < sudoku->trail_count; k++)
+    {
+      if (sudoku->trail[k].pos < 0) grid[-1 - sudoku->trail[k].pos] = '.';
+    }
+}
+
+/*******************************************************************************
+ * deduce() places every digit propagate() can find without guessing, and
+ * place_digit() places one more digit first, as a hint added after
+ * load_sudoku(). Both go through the trail like everything else, so
+ * undo_changes() can take back the digit and all that followed from it.
+ * An entry already holding the digit needs nothing more; one holding
+ * another digit, or where the digit has been ruled out, cannot take it.
+*******************************************************************************/
+
+int deduce(struct Sudoku* sudoku)
+{
+  return propagate(sudoku);
+}
+
+int place_digit(struct Sudoku* sudoku, int pos, int digit)
+{
+  unsigned long bit = 1UL << digit;
+  if (sudoku->grid[pos] != '.') return sudoku->grid[pos] == DIGITS[digit];
+  if (!(sudoku->cand[pos] & bit)) return NO;
+  return assign(sudoku, pos, bit) && propagate(sudoku);
+}
+
+void undo_changes(struct Sudoku* sudoku, int mark)
+{
+  undo(sudoku, mark);
+}
@@ -0,0 +1,180 @@
+/*******************************************************************************
+ * Joseph Adams
+ *
+ * solver.h is a header file to be used in the source file sudoku.c
+ *
+ * solver.h defines the Sudoku struct, which holds one puzzle and all of the
+ * state needed to solve it, along with load_sudoku(), which fills it from a
+ * line of input, no_solution_check(), which looks for blank entries with no
+ * candidates, solve(), the solver itself, and count_solutions(), which
+ * checks whether a puzzle has more than one solution. Since no state is
+ * kept outside the struct, each thread can solve puzzles with its own Sudoku.
+ * The SearchStats in each Sudoku count the work done on its puzzle.
+ *
+ * deduce(), place_digit() and undo_changes() let a Sudoku be changed a
+ * hint at a time and put back, as the editor in editor.c does.
+ *
+ * The share hook lets several Sudokus search one puzzle together, as in
+ * team.c: it is called before every guess, can hand untried guesses to
+ * other threads with branch_grid(), and stops the search by returning YES.
+ *
+ * The size of the puzzle is fixed when the program is compiled. BOX is the
+ * width of a square block, 3 by default for the usual 9x9 puzzle. Compiling
+ * with -DBOX=4 or -DBOX=5 gives a solver for 16x16 or 25x25 puzzles, with
+ * every loop bound and mask width known to the compiler.
+*******************************************************************************/
+
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#define YES 1
+#define NO 0
+
+#ifndef BOX
+#define BOX 3
+#endif
+#define SIZE (BOX*BOX)
+/*SIZE is the number of digits, and of entries in each row, column and block.*/
+#define CELLS (SIZE*SIZE)
+/*CELLS is the number of entries in the puzzle.*/
+#define UNITS (3*SIZE)
+/*UNITS is the number of rows, columns and blocks together.*/
+#define PEERS (2*(SIZE - 1) + (BOX - 1)*(BOX - 1))
+/*PEERS is the number of other entries sharing a row, column or block.*/
+#define ALL_DIGITS ((2UL << (SIZE - 1)) - 1)
+/*ALL_DIGITS is the candidate mask with every digit bit set.*/
+#define DIGITS "123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ0"
+/*
+DIGITS holds the character for each digit, in order. A 9x9 puzzle uses '1'
+to '9', a 16x16 puzzle '1' to 'G', a 25x25 puzzle '1' to 'P' and a 36x36
+puzzle '1' to 'Z' followed by '0'.
+*/
+#if BOX == 3
+#define MIN_HINTS 17
+#else
+#define MIN_HINTS 0
+#endif
+/*
+MIN_HINTS is the fewest hints a puzzle with one solution can have. It has
+been shown to be 17 for 9x9 puzzles; no bound is used for larger ones.
+*/
+
+#define SOLVED 0
+#define ERROR 1
+#define NO_SOLUTION 2
+#define MULTIPLE 3
+#define TIMEOUT 4
+#define RESULTS 5
+/*
+These are the possible results of a puzzle, as printed by sudoku.c and
+stored in a packed result file. RESULTS is the number of them.
+*/
+
+#if SIZE <= 16
+typedef unsigned short mask_t;
+#elif SIZE <= 32
+typedef unsigned int mask_t;
+#else
+typedef unsigned long mask_t;
+#endif
+/*mask_t is the smallest type holding one bit per digit.*/
+
+struct SearchStats
+{
+  unsigned long nodes;        /* calls of the search, one per guess tried */
+  unsigned long backtracks;   /* guesses that had to be undone */
+  unsigned long propagations; /* digits placed by propagation rules */
+  int max_depth;              /* most guesses in effect at once */
+};
+
+#define TRAIL_SIZE (CELLS*SIZE)
+/*
+TRAIL_SIZE bounds the changes that can be undone. Each blank entry loses a
+candidate at most SIZE - 1 times and is filled in once.
+*/
+
+struct Change
+{
+  int pos;    /* entry changed, or -1 - pos if a digit was placed there */
+  mask_t old; /* candidates of the entry before the change */
+};
+
+struct Guess
+{
+  int pos;          /* entry guessed at */
+  mask_t remaining; /* candidates not tried yet */
+  int mark;         /* trail_count before the guess was placed */
+};
+
+struct Sudoku
+{
+  char grid[CELLS];           /* entries from DIGITS, '.' for blank */
+  mask_t row_mask[SIZE];      /* digits already placed in each row */
+  mask_t col_mask[SIZE];      /* digits already placed in each column */
+  mask_t box_mask[SIZE];      /* digits already placed in each block */
+  mask_t cand[CELLS];         /* digits still possible at each blank entry */
+  int empty[CELLS];           /* positions i*SIZE + j of the blank entries */
+  int slot[CELLS];            /* index in empty[] of each blank position */
+  int empty_count;            /* number of positions at the front of empty */
+  int queue[CELLS];           /* blank entries left with one candidate */
+  int queue_count;            /* number of positions in queue */
+  struct Change trail[TRAIL_SIZE]; /* every change since load_sudoku() */
+  int trail_count;            /* number of changes in trail */
+  struct Guess guesses[CELLS]; /* the guesses the search is inside of */
+  struct SearchStats stats;   /* counted by load_sudoku() onwards */
+  unsigned long node_limit;   /* most nodes a search may use, 0 for no limit */
+  unsigned long time_limit;   /* most ns a search may take, 0 for no limit */
+  int timed_out;              /* set if the last search hit a limit */
+  int (*share)(struct Sudoku* sudoku, int depth);
+  /* called before each guess of a shared search, NULL otherwise */
+  void* team;                 /* the search team this Sudoku works for */
+};
+
+extern int digit_value[256];
+/*
+digit_value[] gives the digit (0 to SIZE - 1) of each character of DIGITS,
+and -1 for every other character.
+*/
+
+/* Build the tables of rows, columns and blocks used by the solver.
+ * Call once before any other function in this file. */
+void solver_init(void);
+
+/* Load the CELLS entries of puzzle into sudoku.
+ * Return NO if a hint repeats a digit in its row, column or block. */
+int load_sudoku(struct Sudoku* sudoku, const char* puzzle);
+
+/* Return YES if some blank entry has no legal candidates. */
+int no_solution_check(struct Sudoku* sudoku);
+
+/* Return YES if sudoku has no blank entries left. */
+int solved_check(struct Sudoku* sudoku);
+
+/* Fill in the blanks of sudoku by constraint propagation and backtracking
+ * search. Return YES if a solution was found, otherwise NO. If the search
+ * gave up at node_limit or time_limit, NO is returned and timed_out set. */
+int solve(struct Sudoku* sudoku);
+
+/* Count the solutions of sudoku, stopping once limit have been found.
+ * Return the number found and leave the first one in sudoku->grid.
+ * If timed_out is set, the search gave up and the count is too low. */
+int count_solutions(struct Sudoku* sudoku, int limit);
+
+/* Write into grid the entries of sudoku as they were when guess number
+ * level of the current search was made. */
+void branch_grid(const struct Sudoku* sudoku, int level, char* grid);
+
+/* Place every digit that can be deduced without guessing. Return NO if
+ * that shows the puzzle has no solution. */
+int deduce(struct Sudoku* sudoku);
+
+/* Place digit (0 to SIZE - 1) at the entry pos and deduce what follows.
+ * Return NO if the puzzle is left without a solution; the changes made
+ * are still on the trail. */
+int place_digit(struct Sudoku* sudoku, int pos, int digit);
+
+/* Take back every change made since trail_count was mark. Nothing found
+ * by a search may be left in sudoku->grid when this is called. */
+void undo_changes(struct Sudoku* sudoku, int mark);
+
+#endif
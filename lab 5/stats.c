@@ -0,0 +1,182 @@
+/*******************************************************************************
+ * Joseph Adams
+ *
+ * stats.c is a source file implementing the functions found in stats.h.
+ * These functions are used to measure how long each puzzle takes and to
+ * summarize the times of a whole run.
+ *
+ * Keeping every time would need memory for every puzzle in the input, so the
+ * times are counted in a log-scaled histogram instead. The percentiles it
+ * gives are close enough to tell a 10us puzzle from a 2s one, and the
+ * slowest puzzles are kept exactly.
+*******************************************************************************/
+
+
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <string.h>
+#include <time.h>
+#include "stats.h"
+
+
+/*******************************************************************************
+ * latency_now() reads the monotonic clock, which is not affected by changes
+ * to the time of day, and returns it in nanoseconds.
+*******************************************************************************/
+
+unsigned long latency_now(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (unsigned long)now.tv_sec*1000000000UL + now.tv_nsec;
+}
+
+/*******************************************************************************
+ * bucket() returns the histogram bucket of the time ns. The bucket of a time
+ * of 16ns or more is found from the position of its highest set bit, e, and
+ * the three bits below it, which choose one of 8 buckets for that power of
+ * two. bucket_middle() goes the other way and returns the time in the
+ * middle of a bucket.
+*******************************************************************************/
+
+static int bucket(unsigned long ns)
+{
+  int e = 0;
+  if (ns < 16) return ns;
+  while (ns >> (e + 1)) e++;
+  return 16 + (e - 4)*8 + (int)((ns >> (e - 3)) & 7);
+}
+
+static double bucket_middle(int index)
+{
+  int e;
+  int sub;
+  if (index < 16) return index;
+  e = (index - 16)/8 + 4;
+  sub = (index - 16)%8;
+  return (double)((8UL + sub) << (e - 3)) + (double)(1UL << (e - 3))/2;
+}
+
+/*******************************************************************************
+ * add_slow() puts puzzle into slowest[], which is kept sorted from slowest
+ * to fastest, if it is slower than the last one there or there is room.
+*******************************************************************************/
+
+static void add_slow(struct Latency* latency, const struct SlowPuzzle* puzzle)
+{
+  int k = latency->slowest_count;
+  if (k == SLOWEST)
+    {
+      if (puzzle->ns <= latency->slowest[SLOWEST - 1].ns) return;
+      k--;
+    }
+  else latency->slowest_count++;
+  while (k > 0 && latency->slowest[k - 1].ns < puzzle->ns)
+    {
+      latency->slowest[k] = latency->slowest[k - 1];
+      k--;
+    }
+  latency->slowest[k] = *puzzle;
+}
+
+/*******************************************************************************
+ * add_search() adds the counts of one SearchStats to another, keeping the
+ * largest max_depth.
+*******************************************************************************/
+
+static void add_search(struct SearchStats* into, const struct SearchStats* from)
+{
+  into->nodes += from->nodes;
+  into->backtracks += from->backtracks;
+  into->propagations += from->propagations;
+  if (from->max_depth > into->max_depth) into->max_depth = from->max_depth;
+}
+
+void latency_record(struct Latency* latency, long line, unsigned long ns,
+                    const struct SearchStats* search)
+{
+  struct SlowPuzzle puzzle;
+  latency->histogram[bucket(ns)]++;
+  latency->count++;
+  latency->total_ns += ns;
+  if (ns > latency->max_ns) latency->max_ns = ns;
+  add_search(&latency->search, search);
+  puzzle.line = line;
+  puzzle.ns = ns;
+  puzzle.search = *search;
+  add_slow(latency, &puzzle);
+}
+
+void latency_merge(struct Latency* into, const struct Latency* from)
+{
+  int k;
+  for (k = 0; k < HISTOGRAM_BUCKETS; k++)
+    {
+      into->histogram[k] += from->histogram[k];
+    }
+  into->count += from->count;
+  into->total_ns += from->total_ns;
+  if (from->max_ns > into->max_ns) into->max_ns = from->max_ns;
+  add_search(&into->search, &from->search);
+  for (k = 0; k < from->slowest_count; k++) add_slow(into, &from->slowest[k]);
+}
+
+/*******************************************************************************
+ * latency_percentile() returns the time that fraction p of the puzzles took
+ * at most, by walking the histogram until it has passed that many puzzles.
+ * The middle of the bucket it stops in is returned, except that it never
+ * returns more than the exact maximum.
+*******************************************************************************/
+
+double latency_percentile(const struct Latency* latency, double p)
+{
+  unsigned long target = (unsigned long)(p*latency->count + 0.5);
+  unsigned long seen = 0;
+  int k;
+  if (target < 1) target = 1;
+  for (k = 0; k < HISTOGRAM_BUCKETS; k++)
+    {
+      seen += latency->histogram[k];
+      if (seen >= target)
+        {
+          double middle = bucket_middle(k);
+          return middle < latency->max_ns ? middle : latency->max_ns;
+        }
+    }
+  return latency->max_ns;
+}
+
+/*******************************************************************************
+ * latency_report() prints the summary of a run. Times are given in
+ * microseconds.
+*******************************************************************************/
+
+void latency_report(FILE* out, const struct Latency* latency)
+{
+  int k;
+  if (latency->count == 0)
+    {
+      fprintf(out, "puzzles: 0\n");
+      return;
+    }
+  fprintf(out, "puzzles: %lu, total %.3f ms\n", latency->count,
+          latency->total_ns/1e6);
+  fprintf(out, "latency us: mean %.2f p50 %.2f p90 %.2f p99 %.2f max %.2f\n",
+          latency->total_ns/latency->count/1e3,
+          latency_percentile(latency, 0.50)/1e3,
+          latency_percentile(latency, 0.90)/1e3,
+          latency_percentile(latency, 0.99)/1e3, latency->max_ns/1e3);
+  fprintf(out, "search: %lu nodes, %lu backtracks, %lu propagations, "
+          "max depth %d\n", latency->search.nodes, latency->search.backtracks,
+          latency->search.propagations, latency->search.max_depth);
+  fprintf(out, "slowest:\n");
+  for (k = 0; k < latency->slowest_count; k++)
+    {
+      const struct SlowPuzzle* puzzle = &latency->slowest[k];
+      fprintf(out, "  line %ld: %.2f us, %lu nodes, %lu backtracks, "
+              "%lu propagations, max depth %d\n", puzzle->line,
+              puzzle->ns/1e3, puzzle->search.nodes, puzzle->search.backtracks,
+              puzzle->search.propagations, puzzle->search.max_depth);
+    }
+}
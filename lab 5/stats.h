@@ -0,0 +1,62 @@
+/*******************************************************************************
+ * Joseph Adams
+ *
+ * stats.h is a header file to be used in the source file sudoku.c
+ *
+ * stats.h defines the Latency struct, which collects the time taken by each
+ * puzzle in a histogram along with the search counts of solver.h, and the
+ * functions used to fill it in, combine the ones kept by different threads
+ * and print a summary.
+*******************************************************************************/
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include "solver.h"
+
+#define HISTOGRAM_BUCKETS 496
+/*
+ * Times below 16ns get a bucket each. Above that, every power of two is
+ * split into 8 buckets, so a percentile read from the histogram is within
+ * 1/16 of the true value.
+ */
+#define SLOWEST 10
+/*SLOWEST is the number of slowest puzzles remembered.*/
+
+struct SlowPuzzle
+{
+  long line;                 /* line number of the puzzle in the input */
+  unsigned long ns;          /* time taken in nanoseconds */
+  struct SearchStats search; /* work done on the puzzle */
+};
+
+struct Latency
+{
+  unsigned long histogram[HISTOGRAM_BUCKETS];
+  unsigned long count;       /* puzzles recorded */
+  double total_ns;           /* sum of all their times */
+  unsigned long max_ns;      /* longest time */
+  struct SearchStats search; /* counts added up; max_depth is the largest */
+  struct SlowPuzzle slowest[SLOWEST]; /* slowest puzzles, slowest first */
+  int slowest_count;         /* entries used in slowest[] */
+};
+
+/* Return a monotonic clock reading in nanoseconds. */
+unsigned long latency_now(void);
+
+/* Add a puzzle from input line number line that took ns nanoseconds. */
+void latency_record(struct Latency* latency, long line, unsigned long ns,
+                    const struct SearchStats* search);
+
+/* Add everything recorded in from to into. */
+void latency_merge(struct Latency* into, const struct Latency* from);
+
+/* Return the time in nanoseconds that fraction p of the puzzles took at most,
+ * read from the histogram. */
+double latency_percentile(const struct Latency* latency, double p);
+
+/* Print percentiles, search totals and the slowest puzzles to out. */
+void latency_report(FILE* out, const struct Latency* latency);
+
+#endif
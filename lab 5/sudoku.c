@@ -13,6 +13,46 @@
  * along with a no solution message. Otherwise, the program will solve the
  * puzzles and echo the input along with the solutions for each one.
  *
+ * The program is built for one puzzle size. The default build, sudoku,
+ * solves 9x9 puzzles. sudoku16, sudoku25 and sudoku36 are the same program
+ * compiled with -DBOX=4, -DBOX=5 and -DBOX=6; they read 256, 625 or 1296
+ * character lines using the digits '1' to '9' followed by 'A' to 'G',
+ * 'A' to 'P', or 'A' to 'Z' and then '0'. sudoku36 is meant for the SAT
+ * engine, -e sat, since backtracking is rarely practical at that size.
+ *
+ * Puzzles are read in batches. With the -t option the puzzles of a batch are
+ * solved by several worker threads, each with its own solver state, and the
+ * results are still printed in input order. With the -p option each puzzle
+ * is searched by a team of threads instead, as in team.c, which is what a
+ * single large or hard puzzle needs.
+ *
+ * If a file name is given, the file is mapped into memory and each puzzle is
+ * read straight from the mapping, so large inputs are never copied. The
+ * results are collected in a large buffer and written in big blocks.
+ *
+ * With the -C option, the result of each puzzle is kept in a cache under
+ * its canonical form, so a puzzle that is a relabelling, reordering or
+ * transpose of one already solved is answered from the cache instead. The
+ * cache can be saved to a file with -P and loaded again by the next run.
+ *
+ * The -b and -B options read puzzles and write results in the packed
+ * binary format of pack.h instead of text. A packed record that is not a
+ * valid puzzle does not keep the line it was made from, so with -b its
+ * Error is echoed after a line of CELLS '?' characters instead of that
+ * line. Apart from those lines, the output of -b is the same as for the
+ * text the records were packed from.
+ *
+ * With the -D option the program runs as a daemon instead. It listens on a
+ * Unix domain socket, and each client that connects sends puzzles in the
+ * usual line format and gets the usual output back on the same connection.
+ * Each client has a thread of its own reading its lines, so any number of
+ * them can be connected at once, and their batches take turns on the same
+ * worker threads. The worker threads, the cache and everything else stay
+ * warm from one client to the next, and a puzzle is answered as soon as
+ * its line arrives, so a small request costs microseconds instead of a new
+ * process. A client that leaves the daemon waiting for IDLE_LIMIT seconds
+ * is dropped.
+ *
 *******************************************************************************/
 
 /*******************************************************************************
@@ -21,331 +61,926 @@
  * characters. Providing input with multiple newline characters between
  * puzzles is not expected.
  *
- * 2. This program is not designed to detect puzzles which have multiple
- * solutions. It has been shown that it is impossible to have a sudoku with
- * one unique solution that has 16 or fewer hints. In this case, this program
- * will return an error. For all other cases where there are multiple
- * solutions, this program will simply find one.
+ * 2. Unless the -c option is given, this program is not designed to detect
+ * puzzles which have multiple solutions. It has been shown that it is
+ * impossible to have a sudoku with one unique solution that has 16 or fewer
+ * hints. In this case, this program will return an error. There is no such
+ * check for the larger puzzle sizes. For all other cases where there are
+ * multiple solutions, this program will simply find one. With -c, solutions
+ * are counted instead and puzzles with any number of hints are accepted.
  *
 *******************************************************************************/
 
+#define _POSIX_C_SOURCE 200112L
+
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <signal.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "solver.h"
+#include "stats.h"
+#include "io.h"
+#include "cache.h"
+#include "pack.h"
+#include "engine.h"
 
-#define YES 1
-#define NO 0
+#define BATCH_SIZE 4096
+/*BATCH_SIZE is the most puzzles read into memory before they are printed.*/
+#define CLAIM_SIZE 16
+/*CLAIM_SIZE is the number of puzzles a worker takes from the batch at once.*/
+#define MAX_THREADS 256
+#define CACHE_DEFAULT 65536
+/*CACHE_DEFAULT is the cache size used when -P is given without -C.*/
+#define MAX_CLIENTS 64
+/*MAX_CLIENTS is the most clients the daemon serves at once.*/
+#define IDLE_LIMIT 30
+/*IDLE_LIMIT is the most seconds the daemon waits to read from or write to
+a client before dropping it.*/
+#define CLIENT_BATCH (OUTPUT_SIZE/(2*CELLS + 64))
+/*CLIENT_BATCH is the most lines of a client solved at once, few enough
+that their answers fit in the client's output buffer.*/
+struct Batch
+{
+  char* text;         /* lines read from the standard input */
+  size_t text_size;   /* bytes allocated for text */
+  size_t text_used;   /* bytes of text holding lines */
+  const char* line[BATCH_SIZE]; /* start of each line, in text or the file */
+  int length[BATCH_SIZE];   /* length of each line, without the newline */
+  int hints[BATCH_SIZE];    /* hints of each packed puzzle, -1 if invalid */
+  int result[BATCH_SIZE];   /* SOLVED, ERROR, NO_SOLUTION, ... */
+  int found[BATCH_SIZE];    /* solutions counted when result is MULTIPLE */
+  char solution[BATCH_SIZE][CELLS];
+  int count;          /* lines in the batch */
+  long first_line;    /* input line number of the first line */
+  int next;           /* first line not yet claimed by a worker */
+  int done;           /* lines finished by the workers */
+  int generation;     /* incremented each time a new batch is ready */
+  int quit;           /* set when the workers should exit */
+  pthread_mutex_t lock;
+  pthread_cond_t work;     /* signalled when a new batch is ready */
+  pthread_cond_t finished; /* signalled when done reaches count */
+};
+
+struct Client
+{
+  int fd;                 /* connection to the client */
+  long first_line;        /* number of the client's next line */
+  struct Worker* workers; /* worker threads its batches are solved by */
+  struct Stream stream;   /* lines read from the client */
+  const char* line[BATCH_SIZE]; /* lines of its next batch, in stream */
+  int length[BATCH_SIZE]; /* length of each of those lines */
+  struct Output output;   /* answers waiting to be written to it */
+};
 
-int error = NO;
-/*error is a toggle to note when the program has found an error in the input.*/
-int no_solution = NO;
+struct Engine engine = {BACKTRACK, 0, 1, NULL};
 /*
-no_solution is a toggle used by no_solution_check() to note when the program
-has no solution.
+engine says how puzzles are solved. Its kind is set by the -e option to
+solve with dlx.c or sat.c instead, its count_limit by -c, its team_size by
+-p, and its cache is pointed at cache if -C or -P is given.
 */
-char c;
-/*c is the arbitrary character used to retrieve input characters.*/
-char load[150];
-/*load is an array used to hold input before the creation of sudoku[].*/
-char sudoku[9][9];
-/*sudoku[] is used to hold the actual puzzle itself as it is being solved.*/
+const char* export_prefix = NULL;
+/*export_prefix is set by the -x option to write each puzzle as a formula.*/
+unsigned long node_limit = 0;
+/*node_limit is the most search nodes per puzzle, set by the -n option.*/
+unsigned long time_limit = 0;
+/*time_limit is the most nanoseconds per puzzle, set by the -T option.*/
+int show_stats = NO;
+/*
+show_stats is toggled by the -s option. Only then is each puzzle timed and
+a summary printed at the end.
+*/
+int thread_count = 1;
+/*thread_count is the number of worker threads, set with the -t option.*/
+struct Batch batch;
+/*batch holds the puzzles currently being solved and their results.*/
+struct MappedFile input;
+/*input is the file named on the command line, or has NULL data if none.*/
+struct Output output = {1, 0};
+/*output collects everything printed to the standard output stream.*/
+struct Cache cache;
+/*cache holds the results of puzzles by canonical form, if -C or -P is set.*/
+int packed_input = NO;
+/*packed_input is toggled by the -b option to read packed puzzles.*/
+int packed_output = NO;
+/*packed_output is toggled by the -B option to write packed results.*/
+unsigned long records_left = PACK_UNKNOWN;
+/*records_left is the number of packed puzzles not read yet, if known.*/
+volatile sig_atomic_t stopping = NO;
+/*stopping is set by SIGINT or SIGTERM to shut the daemon down.*/
+pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+/*pool_lock is held by the daemon client whose lines are in batch.*/
+struct Client* clients[MAX_CLIENTS];
+/*clients[] are the clients connected to the daemon, NULL for free slots.*/
+int client_count = 0;
+/*client_count is the number of clients in clients[].*/
+pthread_mutex_t clients_lock = PTHREAD_MUTEX_INITIALIZER;
+/*clients_lock guards clients[] and client_count.*/
+pthread_cond_t client_left = PTHREAD_COND_INITIALIZER;
+/*client_left is signalled whenever a client is taken out of clients[].*/
+
+/*******************************************************************************
+ * export_cnf() writes the formula sat.c would solve for line to a file
+ * named by export_prefix followed by the line number and ".cnf".
+*******************************************************************************/
+
+void export_cnf(struct Worker* worker, const char* line, long number)
+{
+  char* name = malloc(strlen(export_prefix) + 32);
+  FILE* file;
+  if (name == NULL) return;
+  sprintf(name, "%s%ld.cnf", export_prefix, number);
+  file = fopen(name, "w");
+  if (file == NULL || !sat_export(&worker->sat, line, file)) perror(name);
+  if (file != NULL && fclose(file) != 0) perror(name);
+  free(name);
+}
 
 /*******************************************************************************
- * possible() is a function used to determine if an entry n is a possible
- * solution for the entry at the position i,j. It does this by checking to see
- * if n exists in the row, column, or square block of our entry. If it finds n
- * at any of these locations, it returns NO so show that n would be an illegal
- * entry. If it searches and does not find n, it returns YES to show it would
- * be legal.
+ * solve_line() works out the result of line k of the batch using the solver
+ * state of worker, with solve_puzzle() from engine.c. A packed puzzle was
+ * already checked by unpack_puzzle(), which found its hints, so it is not
+ * checked again. With -x, the formula of every legal puzzle is written out
+ * once it has been solved.
  *
- * Other than the iteration variable k, possible() has the local variables 
- * i0 and j0. These are used to iterate over the square block of our entry. 
- * They will be the index for the top left entry of the square block we are in. 
+ * The result is stored in batch.result[k], any count of solutions in
+ * batch.found[k] and any solution in batch.solution[k]. If show_stats is
+ * set, the time taken and the search counts of whichever engine ran are
+ * recorded in worker->latency.
 *******************************************************************************/
 
-int possible(int i, int j, char n)
+void solve_line(struct Worker* worker, int k)
 {
-  int i0 = (i/3)*3;
-  int j0 = (j/3)*3;
-  int k;
-  for(k = 0; k < 9; k++)
+  const char* line = batch.line[k];
+  int result;
+  int found = 0;
+  unsigned long start = show_stats ? latency_now() : 0;
+
+  if (packed_input &&
+      batch.hints[k] < (engine.count_limit ? 0 : MIN_HINTS)) result = ERROR;
+  else
+    {
+      result = solve_puzzle(&engine, worker, line, batch.length[k],
+                            packed_input, &found);
+    }
+
+  batch.result[k] = result;
+  batch.found[k] = found;
+  if (result == SOLVED)
     {
-      if (k == j) continue;
-      if (sudoku[i][k] == n) return NO;
+      memcpy(batch.solution[k], worker->sudoku.grid, CELLS);
     }
-  for(k = 0; k < 9; k++)
+  if (show_stats)
     {
-      if (k == i) continue;
-      if (sudoku[k][j] == n) return NO;
+      struct SearchStats none = {0, 0, 0, 0};
+      const struct SearchStats* search = &none;
+      int timed_out;
+      if (result != ERROR) search = engine_search(&engine, worker, &timed_out);
+      latency_record(&worker->latency, batch.first_line + k,
+                     latency_now() - start, search);
     }
-  for(k = 0; k < 3; k++)
+  if (export_prefix != NULL && result != ERROR)
     {
-      int m;
-      for(m = 0; m < 3; m++)
+      export_cnf(worker, line, batch.first_line + k);
+    }
+}
+
+/*******************************************************************************
+ * worker_main() is run by every worker thread. It waits for a batch with a
+ * new generation number, then claims CLAIM_SIZE lines at a time from
+ * batch.next and solves them with its own Worker, so no solver state is
+ * shared. When the last line of the batch is done it wakes up main(). It
+ * returns once batch.quit is set.
+*******************************************************************************/
+
+void* worker_main(void* arg)
+{
+  struct Worker* worker = arg;
+  int generation = 0;
+
+  pthread_mutex_lock(&batch.lock);
+  for (;;)
+    {
+      while (!batch.quit && batch.generation == generation)
         {
-          if (i0 + k == i && j0 + m == j) continue;
-          if (sudoku[i0 + k][j0 + m] == n) return NO;
+          pthread_cond_wait(&batch.work, &batch.lock);
+        }
+      if (batch.quit) break;
+      generation = batch.generation;
+      while (batch.next < batch.count)
+        {
+          int first = batch.next;
+          int last = first + CLAIM_SIZE;
+          int k;
+          if (last > batch.count) last = batch.count;
+          batch.next = last;
+          pthread_mutex_unlock(&batch.lock);
+          for (k = first; k < last; k++) solve_line(worker, k);
+          pthread_mutex_lock(&batch.lock);
+          batch.done += last - first;
+          if (batch.done == batch.count) pthread_cond_signal(&batch.finished);
         }
     }
-  return YES;
+  pthread_mutex_unlock(&batch.lock);
+  return NULL;
 }
 
 /*******************************************************************************
- * no_solution_check() is a preliminary check used to make sure that every
- * entry in our puzzle has at least one solution. It iterates through the
- * puzzle using the iteration variables a and b as indexes for sudoku[].
- * It then uses the iteration variable char d to iterate through all possible
- * characters. Using the function possible(), it determines if each d is
- * possible at position a,b. If there is such a d possible, it will toggle
- * the local variable solution to YES. If the loop makes it through all
- * possible d's and solution is still NO, it will toggle global variable
- * no_solution to YES since it has found an entry with no solution. 
+ * solve_batch() solves every line of the batch. With one thread, main()
+ * does it itself. With more, it hands the batch to the worker threads by
+ * bumping batch.generation, then waits for batch.finished.
 *******************************************************************************/
 
-void no_solution_check()
+void solve_batch(struct Worker* workers)
+{
+  int k;
+  if (thread_count == 1)
+    {
+      for (k = 0; k < batch.count; k++) solve_line(&workers[0], k);
+      return;
+    }
+  pthread_mutex_lock(&batch.lock);
+  batch.next = 0;
+  batch.done = 0;
+  batch.generation++;
+  pthread_cond_broadcast(&batch.work);
+  while (batch.done < batch.count)
+    {
+      pthread_cond_wait(&batch.finished, &batch.lock);
+    }
+  pthread_mutex_unlock(&batch.lock);
+}
+
+/*******************************************************************************
+ * read_batch() reads up to BATCH_SIZE lines. From a mapped file, the lines
+ * are found with next_line() and batch.line[] points straight at them. From
+ * the standard input, they are read into batch.text, growing it with
+ * realloc() when it runs out of space; since that can move the text,
+ * batch.line[] is only filled in once the whole batch has been read. A line
+ * ends at a newline or at EOF, and the newline itself is not stored. It
+ * returns the number of lines read, which is 0 only at the end of the input.
+ *
+ * read_packed_batch() does the same for packed puzzles, unpacking each one
+ * into its own CELLS characters of batch.text. An invalid record is echoed
+ * as a line of '?' characters. Records are read until records_left runs out
+ * or the input ends.
+*******************************************************************************/
+
+int read_packed_batch()
+{
+  unsigned char buffer[PACK_BYTES];
+  int count = 0;
+
+  while (count < BATCH_SIZE && records_left > 0)
+    {
+      const unsigned char* record = buffer;
+      char* line = batch.text + (size_t)count*CELLS;
+      if (input.data != NULL)
+        {
+          if (input.size - input.pos < PACK_BYTES) break;
+          record = (const unsigned char*)input.data + input.pos;
+          input.pos += PACK_BYTES;
+        }
+      else if (fread(buffer, PACK_BYTES, 1, stdin) != 1) break;
+      if (records_left != PACK_UNKNOWN) records_left--;
+      batch.hints[count] = unpack_puzzle(record, line);
+      if (batch.hints[count] < 0) memset(line, '?', CELLS);
+      batch.line[count] = line;
+      batch.length[count] = CELLS;
+      count++;
+    }
+  return count;
+}
+
+int read_batch()
 {
-  int a;
-  for (a = 0; a < 9; a++)
+  size_t start[BATCH_SIZE];
+  int count = 0;
+  int c;
+
+  if (packed_input) return read_packed_batch();
+  if (input.data != NULL)
     {
-      int b;
-      for (b = 0; b < 9; b++)
+      while (count < BATCH_SIZE &&
+             (batch.line[count] = next_line(&input, &batch.length[count])))
         {
-          int solution = NO;
-          char d;
-          for (d = '1'; d <= '9'; d++)
+          count++;
+        }
+      return count;
+    }
+
+  batch.text_used = 0;
+  while (count < BATCH_SIZE && (c = getchar()) != EOF)
+    {
+      start[count] = batch.text_used;
+      while (c != '\n' && c != EOF)
+        {
+          if (batch.text_used == batch.text_size)
             {
-              if (possible(a, b, d))
+              char* temp;
+              batch.text_size = batch.text_size ? 2*batch.text_size : 65536;
+              temp = realloc(batch.text, batch.text_size);
+              if (temp == NULL)
                 {
-                  solution = YES;
-                  break;
+                  fprintf(stderr, "sudoku: out of memory\n");
+                  exit(1);
                 }
+              batch.text = temp;
             }
-          if (solution == NO)
-            {
-              no_solution = YES;
-              return;
-            }
+          batch.text[batch.text_used++] = c;
+          c = getchar();
         }
+      batch.length[count] = batch.text_used - start[count];
+      count++;
+      if (c == EOF) break;
     }
+  for (c = 0; c < count; c++) batch.line[c] = batch.text + start[c];
+  return count;
 }
 
 /*******************************************************************************
- * load_check() is used to receive input using the global variable char c. It
- * will copy c into the array load[] as long as the max character count is not
- * exceeded. It will also check for illegal characters while doing this. If it
- * finds any, it will toggle the global variable error to yes. It will also
- * use the local variable hint_count to count the number of hints as they are
- * passed to load[]. Once 81 characters have been passed to load[], it will
- * be capped. If the number of characters exceeds 81, load_check() will stop
- * inserting characters into load and will toggle error to yes. If there are
- * too few characters, it will also toggle error to yes. If there are fewer
- * than 17 hints, error will also be toggled to YES since it cannot have a
- * unique solution. The input is always echoed to the output by using
- * putchar(c).
+ * print_batch() echoes every line of the batch in input order, followed by
+ * its solution, "Error", "No solution" or the number of solutions of a
+ * puzzle that is not unique, and the blank line that separates puzzles in
+ * the output. Everything goes through output_write() into out, so most
+ * batches cost only a few calls to write(). With packed_output, each line
+ * becomes one packed result record instead.
 *******************************************************************************/
 
-void load_check()
+#define PRINT(text) output_write(out, text, sizeof(text) - 1)
+
+void print_batch(struct Output* out)
 {
-  int i = 0;
-  int hint_count = 0;
-  
-  while((c != '\n') && (c != EOF))
+  unsigned char record[PACK_RESULT_BYTES];
+  char number[64];
+  int k;
+  for (k = 0; k < batch.count; k++)
     {
-      if(((c >= '1') && (c <= '9')) || c == '.')
+      if (packed_output)
         {
-          if(c != '.') hint_count++;
-          putchar(c);
+          pack_result(batch.result[k], batch.found[k],
+                      batch.result[k] == MULTIPLE &&
+                      batch.found[k] == engine.count_limit,
+                      batch.result[k] == SOLVED ? batch.solution[k] : NULL,
+                      record);
+          output_write(out, (char*)record, PACK_RESULT_BYTES);
+          continue;
         }
-      else
+      output_write(out, batch.line[k], batch.length[k]);
+      PRINT("\n");
+      if (batch.result[k] == SOLVED)
         {
-          putchar(c);
-          error = YES;
+          output_write(out, batch.solution[k], CELLS);
+          PRINT("\n\n");
         }
-      if(i < 81) load[i] = c;
-      c = getchar();
-      i++;
+      else if (batch.result[k] == MULTIPLE)
+        {
+          if (batch.found[k] == engine.count_limit) PRINT("At least ");
+          sprintf(number, "%d", batch.found[k]);
+          output_write(out, number, strlen(number));
+          PRINT(" solutions\n\n");
+        }
+      else if (batch.result[k] == ERROR) PRINT("Error\n\n");
+      else if (batch.result[k] == TIMEOUT) PRINT("Timeout\n\n");
+      else PRINT("No solution\n\n");
     }
-
-  load[i] = '\0';
-  if (hint_count < 17) error = YES;
-  if (i != 81) error = YES;
-  printf("\n");
 }
 
 /*******************************************************************************
- * solved_check() is used to check if a legal puzzle is solved. It is very
- * simple. It iterates through sudoku, using the iteration variables i and j.
- * If it finds a '.' in any position, it will return NO. If it makes it through
- * all the entries without finding a '.' it will return YES.
+ * read_client_batch() reads the next batch of a daemon client into
+ * client->line[]. It takes the lines that have already arrived, up to
+ * CLIENT_BATCH, and only waits for more when there are none, so a client
+ * sending one puzzle at a time gets each answer straight away. It returns
+ * 0 once the client has finished, has gone quiet for IDLE_LIMIT seconds or
+ * the daemon is stopping.
 *******************************************************************************/
 
-int solved_check()
+int read_client_batch(struct Client* client)
 {
-  int i;
-  for(i=0; i<9; i++)
+  int limit = CLIENT_BATCH < BATCH_SIZE ? CLIENT_BATCH : BATCH_SIZE;
+  int count = 0;
+  for (;;)
     {
-      int j;
-      for(j=0; j<9; j++)
+      while (count < limit && (client->line[count] =
+             stream_line(&client->stream, &client->length[count])) != NULL)
         {
-          if(sudoku[i][j] == '.') return NO;
+          count++;
         }
+      if (count > 0 || client->stream.ended || stopping) return count;
+      stream_read(&client->stream);
     }
-  return YES;
 }
 
 /*******************************************************************************
- * solve() is a recursive function that solves the puzzle once all preliminary
- * checks are complete. First, it iterates through sudoku with the iteration
- * variables i and j. It tests all possible characters for each blank entry
- * using the possible() function. If an entry is possible, it increases the
- * local variable counter. The purpose of this part of the function is to
- * find the entry with the fewest legal possibilities before it makeas a guess.
- * As it works through all the entries, it stores the index of the one with 
- * fewest possibilities in the local variables min_i and min_j, and it also
- * stores the number of possibilites for that entry in globalmin.
+ * drop_client() takes client out of clients[], wakes serve() in case it
+ * is waiting for a free slot or for the last client to leave, then closes
+ * the connection and frees the client. Once it is out of clients[], serve()
+ * no longer touches it.
+*******************************************************************************/
+
+void drop_client(struct Client* client)
+{
+  int k;
+  pthread_mutex_lock(&clients_lock);
+  for (k = 0; k < MAX_CLIENTS; k++)
+    {
+      if (clients[k] == client) clients[k] = NULL;
+    }
+  client_count--;
+  pthread_cond_broadcast(&client_left);
+  pthread_mutex_unlock(&clients_lock);
+  close(client->fd);
+  stream_free(&client->stream);
+  free(client);
+}
+
+/*******************************************************************************
+ * client_main() is run by the thread of each daemon client. Its lines are
+ * read without holding anything, so a slow or idle client holds up no one
+ * else. Each batch is then solved by the worker threads and printed into
+ * the client's own output while it holds pool_lock, since batch is shared
+ * by all clients, and written to the client once the lock is let go. The
+ * line numbers in the stats start again at 1 for each client.
+*******************************************************************************/
+
+void* client_main(void* arg)
+{
+  struct Client* client = arg;
+  int count;
+
+  while (!stopping && (count = read_client_batch(client)) > 0)
+    {
+      pthread_mutex_lock(&pool_lock);
+      memcpy(batch.line, client->line, count*sizeof(const char*));
+      memcpy(batch.length, client->length, count*sizeof(int));
+      batch.count = count;
+      batch.first_line = client->first_line;
+      solve_batch(client->workers);
+      print_batch(&client->output);
+      pthread_mutex_unlock(&pool_lock);
+      output_flush(&client->output);
+      client->first_line += count;
+    }
+  drop_client(client);
+  return NULL;
+}
+
+/*******************************************************************************
+ * stop_serving() is the handler of SIGINT and SIGTERM in the daemon. It is
+ * installed without SA_RESTART, so it also breaks accept() out of waiting.
+ * Both signals are blocked while it runs, and in every thread but the one
+ * running serve().
+*******************************************************************************/
+
+void stop_serving(int number)
+{
+  (void)number;
+  stopping = YES;
+}
+
+/*******************************************************************************
+ * add_client() starts a thread serving the connection fd, which is given
+ * IDLE_LIMIT as its timeout for reading and writing, so a client that
+ * stalls ends its own connection. The client is put in a free slot of
+ * clients[] first, since its thread may finish before pthread_create()
+ * returns. If serve() has to wait for a slot, it only waits a second at a
+ * time, so that a signal stopping the daemon is noticed.
+*******************************************************************************/
+
+void add_client(int fd, struct Worker* workers, const sigset_t* signals)
+{
+  struct timeval idle;
+  struct timespec until;
+  struct Client* client;
+  pthread_attr_t attributes;
+  pthread_t thread;
+  int k;
+
+  idle.tv_sec = IDLE_LIMIT;
+  idle.tv_usec = 0;
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &idle, sizeof(idle));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &idle, sizeof(idle));
+  client = malloc(sizeof(struct Client));
+  if (client == NULL)
+    {
+      fprintf(stderr, "sudoku: out of memory\n");
+      close(fd);
+      return;
+    }
+  memset(&client->stream, 0, sizeof(client->stream));
+  client->fd = fd;
+  client->stream.fd = fd;
+  client->output.fd = fd;
+  client->output.used = 0;
+  client->first_line = 1;
+  client->workers = workers;
+
+  pthread_mutex_lock(&clients_lock);
+  while (client_count == MAX_CLIENTS && !stopping)
+    {
+      clock_gettime(CLOCK_REALTIME, &until);
+      until.tv_sec++;
+      pthread_cond_timedwait(&client_left, &clients_lock, &until);
+    }
+  for (k = 0; k < MAX_CLIENTS && clients[k] != NULL; k++) continue;
+  if (k < MAX_CLIENTS)
+    {
+      clients[k] = client;
+      client_count++;
+    }
+  pthread_mutex_unlock(&clients_lock);
+  if (k == MAX_CLIENTS)
+    {
+      close(fd);
+      free(client);
+      return;
+    }
+
+  pthread_attr_init(&attributes);
+  pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+  pthread_sigmask(SIG_BLOCK, signals, NULL);
+  if (pthread_create(&thread, &attributes, client_main, client) != 0)
+    {
+      fprintf(stderr, "sudoku: cannot start a client thread\n");
+      drop_client(client);
+    }
+  pthread_sigmask(SIG_UNBLOCK, signals, NULL);
+  pthread_attr_destroy(&attributes);
+}
+
+/*******************************************************************************
+ * serve() runs the daemon on a Unix domain socket at path, replacing any
+ * socket left there by an earlier run. It accepts clients and hands each
+ * one to add_client(), so up to MAX_CLIENTS are served at once, each by a
+ * thread of its own. A client that goes away early only ends its own
+ * connection, since SIGPIPE is ignored. When SIGINT or SIGTERM arrives,
+ * the connections still open are shut down, so their threads finish the
+ * batch they are on and leave, and once they have all gone the socket is
+ * removed and serve() returns 0, so main() can save the cache and print
+ * the stats as usual. It returns 1 if the socket cannot be set up.
  *
- * Once the function has found the minimum entry, it selects the first
- * possibility and inserts it into the entry. Then it recursively calls itself,
- * starting the process all over again. In the process of finding the minimum
- * entry, if solve() ever finds an entry with no possible solutions, it will
- * return because that implies a higher guess was faulty. When an inner nest
- * of solve() returns, flow of control is returned to the next innermost
- * solve(). When this happens, that solve first checks if the puzzle was
- * solved using solved_check(). It does this because solve() will also return
- * if it finds no blank entries to test. If solved_check() fails, then the
- * previous guess may have been a bad one, so the entry is made blank
- * again before trying a different possibility. If solve() runs out of
- * possibilities for that entry, then it will return, giving control to an
- * even higher invocation of solve(). If this happens for the base invocation,
- * then solve() has tried every legal combination without finding a solution.
- * In this case, it will return the puzzle to its original form, and we know
- * there can be no solution.
+ * accept() is tried again at once only if it was interrupted or the client
+ * gave up before it was accepted. When the process or system is out of
+ * file descriptors or memory, the error is reported and serve() waits a
+ * second before trying again, rather than spinning. Any other error stops
+ * the daemon, and serve() returns 1.
 *******************************************************************************/
 
-void solve()
+int serve(const char* path, struct Worker* workers)
 {
-  int globalmin = 0;
-  int min_i;
-  int min_j;
-  int i;
-  char m;
-  for(i = 0; i < 9; i++)
-    {
-      int j;
-      for(j = 0; j < 9; j++)
-        {
-          if (sudoku[i][j] == '.')
-            {
-              int counter = 0;
-              char n;
-              for(n = '1'; n <= '9'; n++)
-                {
-                  if(possible(i, j, n)) counter++;
-                }
-              if(counter == 0) return;
-              else if(globalmin == 0 || counter < globalmin)
-                {
-                  globalmin = counter;
-                  min_i = i;
-                  min_j = j;
-                }
-            }
-        }
+  struct sockaddr_un address;
+  struct sigaction action;
+  int listener;
+  int status = 0;
+  int k;
+
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(address.sun_path))
+    {
+      fprintf(stderr, "sudoku: socket name too long: %s\n", path);
+      return 1;
     }
-  if(globalmin == 0) return;
-  for(m = '1'; m <= '9'; m++)
+  strcpy(address.sun_path, path);
+  listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listener < 0)
     {
-      if(possible(min_i, min_j, m))
+      perror("socket");
+      return 1;
+    }
+  unlink(path);
+  if (bind(listener, (struct sockaddr*)&address, sizeof(address)) < 0 ||
+      listen(listener, SOMAXCONN) < 0)
+    {
+      perror(path);
+      close(listener);
+      return 1;
+    }
+
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = stop_serving;
+  sigemptyset(&action.sa_mask);
+  sigaddset(&action.sa_mask, SIGINT);
+  sigaddset(&action.sa_mask, SIGTERM);
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
+  signal(SIGPIPE, SIG_IGN);
+  pthread_sigmask(SIG_UNBLOCK, &action.sa_mask, NULL);
+
+  while (!stopping)
+    {
+      int client = accept(listener, NULL, NULL);
+      if (client < 0)
         {
-          sudoku[min_i][min_j] = m;
-          solve();
-          if(!solved_check())
+          int error = errno;
+          if (error == EINTR || error == ECONNABORTED) continue;
+          perror("accept");
+          if (error != EMFILE && error != ENFILE && error != ENOBUFS &&
+              error != ENOMEM)
             {
-              sudoku[min_i][min_j] = '.';
+              status = 1;
+              break;
             }
+          sleep(1);
+          continue;
         }
+      add_client(client, workers, &action.sa_mask);
+    }
+
+  pthread_mutex_lock(&clients_lock);
+  for (k = 0; k < MAX_CLIENTS; k++)
+    {
+      if (clients[k] != NULL) shutdown(clients[k]->fd, SHUT_RDWR);
     }
-  return;
+  while (client_count > 0) pthread_cond_wait(&client_left, &clients_lock);
+  pthread_mutex_unlock(&clients_lock);
+  close(listener);
+  unlink(path);
+  return status;
 }
 
 /*******************************************************************************
- * load_sudoku() creates our puzzle by loading the entries of load[] into 
- * sudoku[] using the iteration variable i. It then uses the possible()
- * function to check if the entries given are, in fact, in legal positions.
- * It does this by using the iteration variables i and j to iterate all
- * entries, and if it is not blank, load_sudoku() will use possible() to check
- * if this non-blank entry is legal. If it isn't, it will toggle the global
- * variable error to YES.
+ * start_packed_input() reads the header of packed input, from the mapped
+ * file or the standard input, and sets up batch.text to unpack into. It
+ * returns NO, after saying why, if the input is not packed puzzles of this
+ * size.
 *******************************************************************************/
 
-void load_sudoku()
+int start_packed_input()
 {
-  int i;
-  for(i = 0; i <= 80; i++)
+  unsigned char buffer[PACK_HEADER];
+  const unsigned char* header = buffer;
+  int kind;
+
+  if (input.data != NULL)
     {
-      sudoku[i/9][i%9] = load[i];
+      header = (const unsigned char*)input.data;
+      if (input.size < PACK_HEADER) header = NULL;
+      else input.pos = PACK_HEADER;
     }
-  sudoku[9][0] = '\0';
-  for(i = 0; i < 9; i++)
+  else if (fread(buffer, PACK_HEADER, 1, stdin) != 1) header = NULL;
+  if (header == NULL || !read_pack_header(header, &kind, &records_left) ||
+      kind != PACK_PUZZLES)
     {
-      int j;
-      for(j = 0; j < 9; j++)
-        {
-          if(sudoku[i][j]!='.')
-            {
-              if(!possible(i, j, sudoku[i][j]))
-                {
-                  error = YES;
-                }
-            }
-        }
+      fprintf(stderr, "sudoku: input is not packed %dx%d puzzles\n", SIZE,
+              SIZE);
+      return NO;
+    }
+  batch.text = malloc((size_t)BATCH_SIZE*CELLS);
+  if (batch.text == NULL)
+    {
+      fprintf(stderr, "sudoku: out of memory\n");
+      return NO;
     }
+  return YES;
 }
-    
+
 /*******************************************************************************
- * main() is pretty easy to understand because it calls these functions in a
- * sensible order. It begins with c = getchar() because load_check() needs c to
- * already be the first entry to work properly. load_check() is the first line 
- * of defence against errors, and if it finds any, the if statements will cause
- * no other functions to be executed and an error statement to be printed.
- *
- * If no errors were found, load_sudoku() is executed and performs its checks.
- * If no errors were found by load_sudoku(), no_solution check() is executed
- * as yet another preliminary test. If this does not toggle no_solution to YES,
- * then the program checks if we were handed an already solved sudoku with the
- * solved_check() function. If we were, that sudoku is printed as the solution.
- *
- * If all these preliminary tests are passed and the sudoku isn't solved,
- * solve() is invoked. After the outermost solve() passes control back to
- * main(), solved_check() is used to see if it solved the puzzle. If it did,
- * the solution is printed. If not, there is no solution and such a statement
- * is printed.
+ * usage() prints the command line options and returns the exit status 1.
+*******************************************************************************/
+
+int usage(const char* name)
+{
+  fprintf(stderr, "usage: %s [-e backtrack|dlx|sat] [-t threads] "
+          "[-p threads] [-c limit] [-n nodes] [-T ms] [-s] [-C entries] "
+          "[-P cachefile] [-b] [-B] [-D socket] [-x prefix] [file]\n", name);
+  return 1;
+}
+
+/*******************************************************************************
+ * main() first reads the command line: "-e dlx" selects the Dancing Links
+ * engine in dlx.c, "-e sat" the CDCL engine in sat.c, and "-e backtrack"
+ * (the default) selects solve(). All engines are given the same checked
+ * puzzle and print the same way, so their output can be compared directly;
+ * for sat, -n limits decisions rather than nodes. "-x prefix" writes the
+ * formula sat.c would solve for each puzzle to prefix1.cnf, prefix2.cnf
+ * and so on, numbered by line, in DIMACS format for other SAT solvers.
+ * "-t n" solves with n threads.
+ * "-p n" searches each puzzle with a team of n threads; it only applies to
+ * the backtracking engine, and with -t every worker gets a team of its own.
+ * "-c n" counts up to n solutions of each puzzle, so "-c 2" checks that
+ * every puzzle has exactly one solution. "-s" times every puzzle and prints
+ * a summary of the run to the standard error stream at the end, so the
+ * normal output is not changed. "-n nodes" and "-T ms" limit the search
+ * nodes and milliseconds spent on each puzzle; a puzzle that hits a limit
+ * prints "Timeout" and the next puzzle is started. A file name reads the
+ * puzzles from that file instead of the standard input. "-C n" keeps the
+ * results of up to n puzzles in the cache, and "-P file" loads the cache
+ * from file at the start and saves it there at the end. A saved cache is
+ * only used by a run with the same -c limit, since the counts depend on it.
+ * "-b" reads packed puzzles and "-B" writes packed results; sudokupack
+ * converts between them and text. "-D socket" runs as a daemon serving
+ * clients on the Unix domain socket called socket, until it is stopped by
+ * SIGINT or SIGTERM; it only speaks the text format. Those signals are
+ * blocked while the threads are started, so only main() ever gets them.
  *
- * main() finishes by resetting error and no_solution before loading the next
- * puzzle using the while loop.
+ * The worker threads are started once, and each batch is solved by
+ * solve_batch() before it is printed and the next one is read.
  *******************************************************************************/
 
-int main(void)
+int main(int argc, char* argv[])
 {
-  while ((c = getchar()) != EOF)
+  struct Worker* workers;
+  const char* cache_file = NULL;
+  const char* socket_path = NULL;
+  int cache_size = 0;
+  int status = 0;
+  int arg;
+  int k;
+
+  for (arg = 1; arg < argc; arg++)
+    {
+      if (strcmp(argv[arg], "-e") == 0 && arg + 1 < argc)
+        {
+          arg++;
+          if (strcmp(argv[arg], "dlx") == 0) engine.kind = DLX;
+          else if (strcmp(argv[arg], "sat") == 0) engine.kind = SAT;
+          else if (strcmp(argv[arg], "backtrack") == 0) engine.kind = BACKTRACK;
+          else return usage(argv[0]);
+        }
+      else if (strcmp(argv[arg], "-t") == 0 && arg + 1 < argc)
+        {
+          thread_count = atoi(argv[++arg]);
+          if (thread_count < 1 || thread_count > MAX_THREADS)
+            {
+              return usage(argv[0]);
+            }
+        }
+      else if (strcmp(argv[arg], "-p") == 0 && arg + 1 < argc)
+        {
+          engine.team_size = atoi(argv[++arg]);
+          if (engine.team_size < 1 || engine.team_size > MAX_THREADS)
+            {
+              return usage(argv[0]);
+            }
+        }
+      else if (strcmp(argv[arg], "-c") == 0 && arg + 1 < argc)
+        {
+          engine.count_limit = atoi(argv[++arg]);
+          if (engine.count_limit < 1) return usage(argv[0]);
+        }
+      else if (strcmp(argv[arg], "-n") == 0 && arg + 1 < argc)
+        {
+          node_limit = strtoul(argv[++arg], NULL, 10);
+        }
+      else if (strcmp(argv[arg], "-T") == 0 && arg + 1 < argc)
+        {
+          time_limit = strtoul(argv[++arg], NULL, 10)*1000000UL;
+        }
+      else if (strcmp(argv[arg], "-s") == 0) show_stats = YES;
+      else if (strcmp(argv[arg], "-C") == 0 && arg + 1 < argc)
+        {
+          cache_size = atoi(argv[++arg]);
+          if (cache_size < 1) return usage(argv[0]);
+        }
+      else if (strcmp(argv[arg], "-P") == 0 && arg + 1 < argc)
+        {
+          cache_file = argv[++arg];
+        }
+      else if (strcmp(argv[arg], "-b") == 0) packed_input = YES;
+      else if (strcmp(argv[arg], "-B") == 0) packed_output = YES;
+      else if (strcmp(argv[arg], "-x") == 0 && arg + 1 < argc)
+        {
+          export_prefix = argv[++arg];
+        }
+      else if (strcmp(argv[arg], "-D") == 0 && arg + 1 < argc)
+        {
+          socket_path = argv[++arg];
+        }
+      else if (argv[arg][0] != '-' && input.data == NULL)
+        {
+          if (map_file(&input, argv[arg]) < 0)
+            {
+              perror(argv[arg]);
+              return 1;
+            }
+        }
+      else return usage(argv[0]);
+    }
+  if (socket_path != NULL && (packed_input || packed_output ||
+                              input.data != NULL)) return usage(argv[0]);
+  if (socket_path != NULL)
+    {
+      sigset_t signals;
+      sigemptyset(&signals);
+      sigaddset(&signals, SIGINT);
+      sigaddset(&signals, SIGTERM);
+      pthread_sigmask(SIG_BLOCK, &signals, NULL);
+    }
+
+  workers = calloc(thread_count, sizeof(struct Worker));
+  if (workers == NULL)
+    {
+      fprintf(stderr, "sudoku: out of memory\n");
+      return 1;
+    }
+  for (k = 0; k < thread_count; k++)
     {
-      load_check();
-      if (error == NO)
+      workers[k].sudoku.node_limit = node_limit;
+      workers[k].sudoku.time_limit = time_limit;
+      workers[k].dlx.node_limit = node_limit;
+      workers[k].dlx.time_limit = time_limit;
+      workers[k].sat.node_limit = node_limit;
+      workers[k].sat.time_limit = time_limit;
+    }
+  if (engine.kind != BACKTRACK) engine.team_size = 1;
+  for (k = 0; k < thread_count && engine.team_size > 1; k++)
+    {
+      if (!team_init(&workers[k].team, engine.team_size, node_limit,
+                     time_limit))
         {
-          load_sudoku();
-          if (error == NO) no_solution_check();
+          fprintf(stderr, "sudoku: out of memory\n");
+          return 1;
         }
-      if (error == YES) printf("Error\n\n");
-      else if (no_solution == NO && solved_check()) printf("%s\n\n", sudoku[0]);
-      else if (error == NO && no_solution == NO)
+    }
+  solver_init();
+  if (packed_input && !start_packed_input()) return 1;
+  if (packed_output)
+    {
+      unsigned char header[PACK_HEADER];
+      pack_header(header, PACK_RESULTS, PACK_UNKNOWN);
+      output_write(&output, (char*)header, PACK_HEADER);
+    }
+  if (cache_file != NULL && cache_size == 0) cache_size = CACHE_DEFAULT;
+  if (cache_size > 0)
+    {
+      if (!cache_init(&cache, cache_size))
+        {
+          fprintf(stderr, "sudoku: out of memory\n");
+          return 1;
+        }
+      if (cache_file != NULL &&
+          !cache_load(&cache, cache_file, engine.count_limit))
         {
-          solve();
-          if(solved_check()) printf("%s\n\n", sudoku[0]);
-          else printf("No solution\n\n");
+          perror(cache_file);
         }
-      else printf("No solution\n\n");
-      error = NO;
-      no_solution = NO;
+      engine.cache = &cache;
+    }
+  pthread_mutex_init(&batch.lock, NULL);
+  pthread_cond_init(&batch.work, NULL);
+  pthread_cond_init(&batch.finished, NULL);
+  if (thread_count > 1)
+    {
+      for (k = 0; k < thread_count; k++)
+        {
+          pthread_create(&workers[k].thread, NULL, worker_main, &workers[k]);
+        }
+    }
+
+  batch.first_line = 1;
+  if (socket_path != NULL) status = serve(socket_path, workers);
+  else
+    {
+      while ((batch.count = read_batch()) > 0)
+        {
+          solve_batch(workers);
+          print_batch(&output);
+          batch.first_line += batch.count;
+        }
+      output_flush(&output);
+      if (packed_output) pack_finish(output.fd, batch.first_line - 1);
     }
-  return 0;
-}
 
-      
+  if (thread_count > 1)
+    {
+      pthread_mutex_lock(&batch.lock);
+      batch.quit = YES;
+      pthread_cond_broadcast(&batch.work);
+      pthread_mutex_unlock(&batch.lock);
+      for (k = 0; k < thread_count; k++) pthread_join(workers[k].thread, NULL);
+    }
+  if (show_stats)
+    {
+      for (k = 1; k < thread_count; k++)
+        {
+          latency_merge(&workers[0].latency, &workers[k].latency);
+        }
+      latency_report(stderr, &workers[0].latency);
+      if (cache.capacity)
+        {
+          fprintf(stderr, "cache: %lu hits, %lu misses, %d entries\n",
+                  cache.hits, cache.misses, cache.used);
+        }
+    }
+  if (cache_file != NULL &&
+      !cache_save(&cache, cache_file, engine.count_limit))
+    {
+      perror(cache_file);
+    }
+  cache_free(&cache);
+  for (k = 0; k < thread_count; k++)
+    {
+      team_free(&workers[k].team);
+      sat_free(&workers[k].sat);
+    }
+  free(workers);
+  free(batch.text);
+  if (input.data != NULL) unmap_file(&input);
+  return status;
+}
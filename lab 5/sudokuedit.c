@@ -0,0 +1,203 @@
+/*******************************************************************************
+ * Joseph Adams
+ *
+ * sudokuedit.c is a program for setting puzzles interactively. It reads
+ * commands one line at a time from a file named on the command line, or
+ * else the standard input, and answers each one as soon as it is read, so
+ * it can sit behind an editor that sends every change as it is made.
+ *
+ * A line of CELLS characters, in the format sudoku.c reads, starts a new
+ * puzzle. A line "row column digit", with the row and column counted from
+ * 1, puts a hint in the puzzle, or takes one away if the digit is '.'.
+ * After each command the puzzle as it now stands is printed, then its
+ * solution or the message sudoku.c would give, then a blank line. A line
+ * that is neither, or an edit before any puzzle, gets "Error".
+ *
+ * Each change is solved again by the Editor of editor.h, which keeps the
+ * hints placed and propagated between commands and often does not need to
+ * search at all. Since a puzzle being set will have few hints to begin
+ * with, there is no lower bound on the hints as there is in sudoku.c.
+ *
+*******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "solver.h"
+#include "stats.h"
+#include "editor.h"
+
+#define LINE_SIZE (CELLS + 2)
+/*LINE_SIZE holds a puzzle line, its newline and the terminating zero.*/
+
+struct Editor editor;
+/*editor holds the puzzle being set.*/
+
+/*******************************************************************************
+ * read_line() reads a line from file into line, without the newline, and
+ * returns its length, or -1 at the end of the file. A line too long for
+ * LINE_SIZE is read to its end and reported as LINE_SIZE characters long,
+ * which no command is.
+*******************************************************************************/
+
+int read_line(FILE* file, char* line)
+{
+  int len;
+  if (fgets(line, LINE_SIZE, file) == NULL) return -1;
+  len = strlen(line);
+  if (len > 0 && line[len - 1] == '\n') line[--len] = '\0';
+  else if (len == LINE_SIZE - 1)
+    {
+      int c;
+      while ((c = getc(file)) != '\n' && c != EOF) continue;
+      len = LINE_SIZE;
+    }
+  return len;
+}
+
+/*******************************************************************************
+ * run_command() carries out the command in line, of length len, and
+ * returns NO if it is not a valid command. *started is set once a puzzle
+ * has been loaded, since there is nothing to edit before that.
+*******************************************************************************/
+
+int run_command(const char* line, int len, int* started)
+{
+  int row;
+  int col;
+  char digit;
+  char rest;
+  int pos;
+
+  if (len == CELLS)
+    {
+      if (!editor_load(&editor, line)) return NO;
+      *started = YES;
+      return YES;
+    }
+  if (!*started || sscanf(line, "%d %d %c %c", &row, &col, &digit,
+                          &rest) != 3) return NO;
+  if (row < 1 || row > SIZE || col < 1 || col > SIZE) return NO;
+  pos = (row - 1)*SIZE + col - 1;
+  if (digit == '.') return editor_remove(&editor, pos);
+  return editor_add(&editor, pos, digit);
+}
+
+/*******************************************************************************
+ * print_result() prints the puzzle being set, then its solution or why
+ * there is none, then a blank line.
+*******************************************************************************/
+
+void print_result(int limit)
+{
+  fwrite(editor.hints, 1, CELLS, stdout);
+  putchar('\n');
+  if (editor.result == SOLVED) fwrite(editor.solution, 1, CELLS, stdout);
+  else if (editor.result == MULTIPLE)
+    {
+      if (editor.found == limit) printf("At least ");
+      printf("%d solutions", editor.found);
+    }
+  else if (editor.result == ERROR) printf("Error");
+  else if (editor.result == TIMEOUT) printf("Timeout");
+  else printf("No solution");
+  printf("\n\n");
+}
+
+/*******************************************************************************
+ * usage() prints the command line options and returns the exit status 1.
+*******************************************************************************/
+
+int usage(const char* name)
+{
+  fprintf(stderr, "usage: %s [-c limit] [-n nodes] [-T ms] [-s] [file]\n",
+          name);
+  return 1;
+}
+
+/*******************************************************************************
+ * main() reads the command line: "-c n" counts up to n solutions, so "-c 2"
+ * says whether the puzzle is unique, while by default one solution is
+ * enough. "-n nodes" and "-T ms" limit the search after each command, as
+ * in sudoku.c. "-s" times every command and prints a summary at the end,
+ * with the number of commands that needed a search. A file name reads the
+ * commands from that file instead of the standard input.
+ *
+ * The output is flushed after every command, so a program at the other
+ * end of a pipe gets each answer straight away.
+*******************************************************************************/
+
+int main(int argc, char* argv[])
+{
+  static struct Latency latency;
+  char line[LINE_SIZE];
+  FILE* file = stdin;
+  unsigned long node_limit = 0;
+  unsigned long time_limit = 0;
+  unsigned long searches = 0;
+  long number = 0;
+  int show_stats = NO;
+  int started = NO;
+  int limit = 1;
+  int arg;
+  int len;
+
+  for (arg = 1; arg < argc; arg++)
+    {
+      if (strcmp(argv[arg], "-c") == 0 && arg + 1 < argc)
+        {
+          limit = atoi(argv[++arg]);
+          if (limit < 1) return usage(argv[0]);
+        }
+      else if (strcmp(argv[arg], "-n") == 0 && arg + 1 < argc)
+        {
+          node_limit = strtoul(argv[++arg], NULL, 10);
+        }
+      else if (strcmp(argv[arg], "-T") == 0 && arg + 1 < argc)
+        {
+          time_limit = strtoul(argv[++arg], NULL, 10)*1000000UL;
+        }
+      else if (strcmp(argv[arg], "-s") == 0) show_stats = YES;
+      else if (argv[arg][0] != '-' && file == stdin)
+        {
+          file = fopen(argv[arg], "r");
+          if (file == NULL)
+            {
+              perror(argv[arg]);
+              return 1;
+            }
+        }
+      else return usage(argv[0]);
+    }
+  solver_init();
+  editor_init(&editor, limit, node_limit, time_limit);
+
+  while ((len = read_line(file, line)) >= 0)
+    {
+      unsigned long start = show_stats ? latency_now() : 0;
+      number++;
+      if (!run_command(line, len, &started))
+        {
+          if (len < LINE_SIZE) fwrite(line, 1, len, stdout);
+          printf("\nError\n\n");
+        }
+      else
+        {
+          if (show_stats)
+            {
+              latency_record(&latency, number, latency_now() - start,
+                             &editor.sudoku.stats);
+            }
+          if (editor.searched) searches++;
+          print_result(limit);
+        }
+      fflush(stdout);
+    }
+  if (show_stats)
+    {
+      latency_report(stderr, &latency);
+      fprintf(stderr, "searches: %lu of %ld commands\n", searches, number);
+    }
+  if (file != stdin) fclose(file);
+  return 0;
+}
@@ -0,0 +1,202 @@
+/*******************************************************************************
+ * Joseph Adams
+ *
+ * sudokupack.c is a program for converting between the text format read by
+ * sudoku.c and the packed binary format of pack.h. It reads a file named on
+ * the command line, or else the standard input, and writes the standard
+ * output stream.
+ *
+ * By default each line of text becomes one packed puzzle. A line that is
+ * not a puzzle is still written, as an invalid record, so record n of the
+ * packed file is always line n of the text and sudoku.c still reports it
+ * as an Error. With -u a packed file is turned back into text: a puzzle
+ * file gives one puzzle per line, and a result file written by sudoku -B
+ * gives one line per result, holding the solution or the message sudoku.c
+ * would have printed.
+ *
+*******************************************************************************/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "solver.h"
+#include "io.h"
+#include "pack.h"
+
+struct Output output = {1, 0};
+/*output collects everything written to the standard output stream.*/
+
+/*******************************************************************************
+ * read_all() reads the whole of the standard input into memory, so it can
+ * be handled the same way as a mapped file.
+*******************************************************************************/
+
+void read_all(struct MappedFile* file)
+{
+  size_t allocated = 65536;
+  char* data = malloc(allocated);
+  size_t n;
+  file->size = 0;
+  file->pos = 0;
+  while (data != NULL &&
+         (n = fread(data + file->size, 1, allocated - file->size, stdin)) > 0)
+    {
+      file->size += n;
+      if (file->size == allocated)
+        {
+          char* temp = realloc(data, 2*allocated);
+          if (temp == NULL) free(data);
+          data = temp;
+          allocated *= 2;
+        }
+    }
+  if (data == NULL)
+    {
+      fprintf(stderr, "sudokupack: out of memory\n");
+      exit(1);
+    }
+  file->data = data;
+}
+
+/*******************************************************************************
+ * pack_text() writes the packed header and then one puzzle record for each
+ * line of file. The count in the header is filled in at the end, if the
+ * output can seek.
+*******************************************************************************/
+
+void pack_text(struct MappedFile* file)
+{
+  unsigned char header[PACK_HEADER];
+  unsigned char record[PACK_BYTES];
+  unsigned long count = 0;
+  const char* line;
+  int len;
+
+  pack_header(header, PACK_PUZZLES, PACK_UNKNOWN);
+  output_write(&output, (char*)header, PACK_HEADER);
+  while ((line = next_line(file, &len)) != NULL)
+    {
+      pack_puzzle(line, len, record);
+      output_write(&output, (char*)record, PACK_BYTES);
+      count++;
+    }
+  output_flush(&output);
+  pack_finish(output.fd, count);
+}
+
+/*******************************************************************************
+ * write_result() writes one unpacked result as a line of text, starting
+ * "At least" when the count stopped at the limit, as sudoku.c does.
+*******************************************************************************/
+
+void write_result(int result, int found, int at_least, const char* solution)
+{
+  char number[64];
+  if (result == SOLVED) output_write(&output, solution, CELLS);
+  else if (result == MULTIPLE)
+    {
+      if (at_least) output_write(&output, "At least ", 9);
+      sprintf(number, "%d solutions", found);
+      output_write(&output, number, strlen(number));
+    }
+  else if (result == ERROR) output_write(&output, "Error", 5);
+  else if (result == TIMEOUT) output_write(&output, "Timeout", 7);
+  else output_write(&output, "No solution", 11);
+  output_write(&output, "\n", 1);
+}
+
+/*******************************************************************************
+ * unpack_file() checks the header of file and writes each record after it
+ * as a line of text. An invalid puzzle record is written as a line of '?'
+ * characters, which sudoku.c will also report as an Error. Returns 1 if the
+ * file is not packed for this size, otherwise 0.
+*******************************************************************************/
+
+int unpack_file(struct MappedFile* file)
+{
+  const unsigned char* data = (const unsigned char*)file->data;
+  unsigned long count;
+  char line[CELLS];
+  int kind;
+  size_t bytes;
+
+  if (file->size < PACK_HEADER || !read_pack_header(data, &kind, &count))
+    {
+      fprintf(stderr, "sudokupack: input is not packed %dx%d puzzles\n",
+              SIZE, SIZE);
+      return 1;
+    }
+  bytes = kind == PACK_PUZZLES ? PACK_BYTES : PACK_RESULT_BYTES;
+  for (file->pos = PACK_HEADER; count > 0 && file->size - file->pos >= bytes;
+       file->pos += bytes)
+    {
+      const unsigned char* record = data + file->pos;
+      if (count != PACK_UNKNOWN) count--;
+      if (kind == PACK_PUZZLES)
+        {
+          if (unpack_puzzle(record, line) < 0) memset(line, '?', CELLS);
+          output_write(&output, line, CELLS);
+          output_write(&output, "\n", 1);
+        }
+      else
+        {
+          int result;
+          int found;
+          int at_least;
+          unpack_result(record, &result, &found, &at_least, line);
+          write_result(result, found, at_least, line);
+        }
+    }
+  output_flush(&output);
+  return 0;
+}
+
+/*******************************************************************************
+ * usage() prints the command line options and returns the exit status 1.
+*******************************************************************************/
+
+int usage(const char* name)
+{
+  fprintf(stderr, "usage: %s [-u] [file]\n", name);
+  return 1;
+}
+
+/*******************************************************************************
+ * main() reads the command line: "-u" unpacks instead of packing, and a
+ * file name is read in place of the standard input.
+*******************************************************************************/
+
+int main(int argc, char* argv[])
+{
+  struct MappedFile file;
+  int mapped = NO;
+  int unpack = NO;
+  int status = 0;
+  int arg;
+
+  file.data = NULL;
+  for (arg = 1; arg < argc; arg++)
+    {
+      if (strcmp(argv[arg], "-u") == 0) unpack = YES;
+      else if (argv[arg][0] != '-' && file.data == NULL)
+        {
+          if (map_file(&file, argv[arg]) < 0)
+            {
+              perror(argv[arg]);
+              return 1;
+            }
+          mapped = YES;
+        }
+      else return usage(argv[0]);
+    }
+  solver_init();
+
+  if (file.data == NULL) read_all(&file);
+  if (unpack) status = unpack_file(&file);
+  else pack_text(&file);
+  if (mapped) unmap_file(&file);
+  else free((char*)file.data);
+  return status;
+}
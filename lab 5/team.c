@@ -0,0 +1,298 @@
+/*******************************************************************************
+ * Joseph Adams
+ *
+ * team.c is a source file implementing the functions found in team.h.
+ * These functions are used to search one puzzle with several threads.
+ *
+ * Each member of the team runs the ordinary search() of solver.c, with its
+ * MRV choice of entry, on whatever task it took from the pool. The only
+ * difference is the share hook, which search() calls before every guess.
+ * Reading hungry and stop there costs next to nothing, so the lock is only
+ * taken when there is work to give away or every 256 nodes, to report
+ * progress against the node and time limits.
+ *
+ * Tasks are only made when a member is waiting for one, so an easy puzzle
+ * is searched by one thread exactly as count_solutions() would, and the
+ * pool never holds more than the waiting members can use.
+*******************************************************************************/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdlib.h>
+#include <string.h>
+#include "team.h"
+#include "stats.h"
+
+#define TASKS 64
+/*TASKS is the number of grids the pool has room for at first.*/
+
+/*******************************************************************************
+ * add_task() makes room in the pool for one more grid and returns it, or
+ * returns NULL if there is no memory left, in which case the caller simply
+ * keeps the work to itself. The lock must be held.
+*******************************************************************************/
+
+static char* add_task(struct Team* team)
+{
+  if (team->task_count == team->task_size)
+    {
+      char (*temp)[CELLS] = realloc(team->task,
+                                    2*team->task_size*sizeof(*team->task));
+      if (temp == NULL) return NULL;
+      team->task = temp;
+      team->task_size *= 2;
+    }
+  return team->task[team->task_count++];
+}
+
+/*******************************************************************************
+ * give_away() moves the untried candidates of the oldest guess of sudoku
+ * that still has some into the pool, one task for each, and wakes up the
+ * members waiting for them. The guess is left with nothing remaining, so
+ * sudoku will not search those candidates itself. Nothing is given if the
+ * pool already has a task for every waiting member. The lock must be held.
+*******************************************************************************/
+
+static void give_away(struct Team* team, struct Sudoku* sudoku, int depth)
+{
+  struct Guess* guess;
+  char grid[CELLS];
+  int level;
+
+  if (team->task_count >= team->hungry) return;
+  for (level = 0; level < depth; level++)
+    {
+      if (sudoku->guesses[level].remaining != 0) break;
+    }
+  if (level == depth) return;
+  guess = &sudoku->guesses[level];
+  branch_grid(sudoku, level, grid);
+  while (guess->remaining != 0)
+    {
+      unsigned long bit = guess->remaining & -guess->remaining;
+      char* task = add_task(team);
+      int digit = 0;
+      if (task == NULL) break;
+      while (!(bit >> digit & 1)) digit++;
+      memcpy(task, grid, CELLS);
+      task[guess->pos] = DIGITS[digit];
+      guess->remaining ^= bit;
+    }
+  pthread_cond_broadcast(&team->work);
+}
+
+/*******************************************************************************
+ * share() is the hook search() calls before each guess of a member. Every
+ * 256 nodes it adds them to team->nodes and checks the limits, stopping the
+ * whole team once one is passed. It gives work away when some member is
+ * waiting, and returns YES once the team has stopped.
+*******************************************************************************/
+
+static int share(struct Sudoku* sudoku, int depth)
+{
+  struct Team* team = sudoku->team;
+
+  if ((sudoku->stats.nodes & 255) == 0)
+    {
+      pthread_mutex_lock(&team->lock);
+      team->nodes += 256;
+      if ((team->node_limit && team->nodes > team->node_limit) ||
+          (team->deadline && latency_now() > team->deadline))
+        {
+          team->timed_out = YES;
+          team->stop = YES;
+          pthread_cond_broadcast(&team->work);
+        }
+      pthread_mutex_unlock(&team->lock);
+    }
+  if (team->stop) return YES;
+  if (team->hungry)
+    {
+      pthread_mutex_lock(&team->lock);
+      give_away(team, sudoku, depth);
+      pthread_mutex_unlock(&team->lock);
+    }
+  return NO;
+}
+
+/*******************************************************************************
+ * take_part() is run by every member, with the lock held, for each search.
+ * It takes tasks from the pool and counts the solutions of each one, only
+ * looking for as many as the team still needs. While the pool is empty it
+ * waits, counted in hungry, until some other member gives work away. When
+ * the team has stopped, or the pool is empty and nobody is busy, every
+ * part of the search has been done and it returns.
+ *
+ * A task may use no more nodes than the team has left, so a search that is
+ * never split stops at the same node as count_solutions() would. The nodes
+ * of a task that were not reported by share() are added to team->nodes
+ * when it ends, and its counts to team->stats.
+*******************************************************************************/
+
+static void take_part(struct Team* team, struct Sudoku* sudoku)
+{
+  for (;;)
+    {
+      int limit;
+      int found;
+      while (!team->stop && team->task_count == 0 && team->busy > 0)
+        {
+          team->hungry++;
+          pthread_cond_wait(&team->work, &team->lock);
+          team->hungry--;
+        }
+      if (team->stop || team->task_count == 0) break;
+      load_sudoku(sudoku, team->task[--team->task_count]);
+      limit = team->limit - team->found;
+      if (team->node_limit)
+        {
+          sudoku->node_limit = team->node_limit > team->nodes
+            ? team->node_limit - team->nodes : 1;
+        }
+      team->busy++;
+      pthread_mutex_unlock(&team->lock);
+
+      found = count_solutions(sudoku, limit);
+
+      pthread_mutex_lock(&team->lock);
+      team->busy--;
+      team->nodes += sudoku->stats.nodes & 255;
+      team->stats.nodes += sudoku->stats.nodes;
+      team->stats.backtracks += sudoku->stats.backtracks;
+      team->stats.propagations += sudoku->stats.propagations;
+      if (sudoku->stats.max_depth > team->stats.max_depth)
+        {
+          team->stats.max_depth = sudoku->stats.max_depth;
+        }
+      if (sudoku->timed_out)
+        {
+          team->timed_out = YES;
+          team->stop = YES;
+        }
+      if (found > 0)
+        {
+          if (team->found == 0) memcpy(team->first, sudoku->grid, CELLS);
+          team->found += found;
+          if (team->found >= team->limit) team->stop = YES;
+        }
+      if (team->stop || team->busy == 0) pthread_cond_broadcast(&team->work);
+    }
+}
+
+/*******************************************************************************
+ * helper_main() is run by every thread of the team but the caller. It
+ * waits for a search with a new generation number, takes part in it, and
+ * wakes up team_count() once the last helper is done. It returns once
+ * team->quit is set.
+*******************************************************************************/
+
+static void* helper_main(void* arg)
+{
+  struct Sudoku* sudoku = arg;
+  struct Team* team = sudoku->team;
+  int generation = 0;
+
+  pthread_mutex_lock(&team->lock);
+  for (;;)
+    {
+      while (!team->quit && team->generation == generation)
+        {
+          pthread_cond_wait(&team->work, &team->lock);
+        }
+      if (team->quit) break;
+      generation = team->generation;
+      take_part(team, sudoku);
+      if (--team->working == 0) pthread_cond_signal(&team->finished);
+    }
+  pthread_mutex_unlock(&team->lock);
+  return NULL;
+}
+
+int team_init(struct Team* team, int size, unsigned long node_limit,
+              unsigned long time_limit)
+{
+  int k;
+  memset(team, 0, sizeof(struct Team));
+  team->member = calloc(size, sizeof(struct Sudoku));
+  team->thread = calloc(size, sizeof(pthread_t));
+  team->task = malloc(TASKS*sizeof(*team->task));
+  if (team->member == NULL || team->thread == NULL || team->task == NULL)
+    {
+      free(team->member);
+      free(team->thread);
+      free(team->task);
+      return NO;
+    }
+  team->size = size;
+  team->task_size = TASKS;
+  team->node_limit = node_limit;
+  team->time_limit = time_limit;
+  pthread_mutex_init(&team->lock, NULL);
+  pthread_cond_init(&team->work, NULL);
+  pthread_cond_init(&team->finished, NULL);
+  for (k = 0; k < size; k++)
+    {
+      team->member[k].share = share;
+      team->member[k].team = team;
+    }
+  for (k = 1; k < size; k++)
+    {
+      pthread_create(&team->thread[k], NULL, helper_main, &team->member[k]);
+    }
+  return YES;
+}
+
+void team_free(struct Team* team)
+{
+  int k;
+  if (team->member == NULL) return;
+  pthread_mutex_lock(&team->lock);
+  team->quit = YES;
+  pthread_cond_broadcast(&team->work);
+  pthread_mutex_unlock(&team->lock);
+  for (k = 1; k < team->size; k++) pthread_join(team->thread[k], NULL);
+  pthread_mutex_destroy(&team->lock);
+  pthread_cond_destroy(&team->work);
+  pthread_cond_destroy(&team->finished);
+  free(team->member);
+  free(team->thread);
+  free(team->task);
+  team->member = NULL;
+}
+
+/*******************************************************************************
+ * team_count() puts the grid of sudoku in the pool as the only task, starts
+ * a new generation so the helpers join in, and takes part itself with the
+ * first member. Once every helper is done it hands back the results. Tasks
+ * finishing at the same moment can count past limit, so the count is cut
+ * back to it.
+*******************************************************************************/
+
+int team_count(struct Team* team, struct Sudoku* sudoku, int limit)
+{
+  int found;
+
+  pthread_mutex_lock(&team->lock);
+  team->task_count = 0;
+  memcpy(add_task(team), sudoku->grid, CELLS);
+  team->busy = 0;
+  team->stop = NO;
+  team->limit = limit;
+  team->found = 0;
+  memset(&team->stats, 0, sizeof(struct SearchStats));
+  team->nodes = 0;
+  team->deadline = team->time_limit ? latency_now() + team->time_limit : 0;
+  team->timed_out = NO;
+  team->working = team->size - 1;
+  team->generation++;
+  pthread_cond_broadcast(&team->work);
+  take_part(team, &team->member[0]);
+  while (team->working > 0) pthread_cond_wait(&team->finished, &team->lock);
+  pthread_mutex_unlock(&team->lock);
+
+  found = team->found < limit ? team->found : limit;
+  if (found > 0) memcpy(sudoku->grid, team->first, CELLS);
+  sudoku->stats = team->stats;
+  sudoku->timed_out = team->timed_out;
+  return found;
+}
@@ -0,0 +1,69 @@
+/*******************************************************************************
+ * Joseph Adams
+ *
+ * team.h is a header file to be used in the source files sudoku.c and
+ * team.c
+ *
+ * team.h defines the Team struct, a group of threads that search a single
+ * puzzle together. A puzzle of 25x25, or a hard one of 16x16, can keep one
+ * thread busy for minutes, and solving puzzles in parallel does not help
+ * when there is only one of them.
+ *
+ * The search is split into tasks, each a grid with some of the guesses
+ * already made. Tasks wait in a pool shared by the whole team. A thread
+ * with nothing to do waits on the pool, and a thread that sees someone
+ * waiting while the pool is empty gives away the untried candidates of its
+ * oldest guess, which are the largest parts of the search it has left.
+ * Whoever finds the solution stops the others; when solutions are counted,
+ * the counts of all tasks are added up.
+*******************************************************************************/
+
+#ifndef TEAM_H
+#define TEAM_H
+
+#include <pthread.h>
+#include "solver.h"
+
+struct Team
+{
+  struct Sudoku* member;  /* solver state of each thread, the caller first */
+  pthread_t* thread;      /* threads of members 1 onwards */
+  int size;               /* threads in the team, counting the caller */
+  char (*task)[CELLS];    /* grids waiting to be searched */
+  int task_count;         /* grids in task */
+  int task_size;          /* grids allocated for task */
+  int busy;               /* members searching a task */
+  volatile int hungry;    /* members waiting for a task */
+  volatile int stop;      /* set once the search is over */
+  int limit;              /* solutions to count before stopping */
+  int found;              /* solutions counted by finished tasks */
+  char first[CELLS];      /* the first solution found */
+  struct SearchStats stats; /* work done by finished tasks */
+  unsigned long nodes;    /* nodes reported so far by running tasks */
+  unsigned long node_limit; /* most nodes for the search, 0 for no limit */
+  unsigned long time_limit; /* most ns for the search, 0 for no limit */
+  unsigned long deadline; /* time the search must end by, or 0 */
+  int timed_out;          /* set if the search hit a limit */
+  int working;            /* helper threads not done with this search */
+  int generation;         /* incremented each time a search starts */
+  int quit;               /* set when the helper threads should exit */
+  pthread_mutex_t lock;
+  pthread_cond_t work;    /* signalled when tasks or a search are added */
+  pthread_cond_t finished; /* signalled when working reaches 0 */
+};
+
+/* Start a team of size threads, counting the one that will call
+ * team_count(). Return NO if it could not be allocated. */
+int team_init(struct Team* team, int size, unsigned long node_limit,
+              unsigned long time_limit);
+
+/* Stop the threads of team and free everything it holds. */
+void team_free(struct Team* team);
+
+/* Count the solutions of sudoku with the whole team, stopping once limit
+ * have been found. Works like count_solutions(): the number found is
+ * returned, the first is left in sudoku->grid, timed_out is set if the
+ * team gave up, and sudoku->stats holds the work of every thread. */
+int team_count(struct Team* team, struct Sudoku* sudoku, int limit);
+
+#endif
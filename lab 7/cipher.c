@@ -19,16 +19,70 @@
  * where action is either 'e' or 'd' for encrypt or decrypt, lgc_m is 1-20
  * digits to be converted to an unsigned long and used at the lgc modulus.
  * lgc_c is another 1-20 digits used as the increment of our lgc.
+ *
+ * With the -t option the data of a long record is split into chunks that
+ * are converted by several threads at once. Each chunk starts its LCG at
+ * the right place in the sequence with skipRandomValues(), so the output
+ * is exactly what one thread would have printed. A key whose LCG cannot
+ * jump ahead is converted by one thread, since stepping to each chunk's
+ * place would take longer than converting it.
+ *
+ * The data of a record is read and converted WINDOW bytes per thread at a
+ * time, and each window is printed before the next is read, so a record
+ * of any length is converted in the same bounded amount of memory.
+ *
+ * The input is read and the output written BLOCK_SIZE bytes at a time with
+ * read() and write(), rather than a character at a time through stdio. The
+ * output is flushed whenever more input is needed, so someone typing
+ * records still sees each answer as soon as the line is finished.
+ *
+ * The lcg for each key, that is each pair of m and c, is made once and kept
+ * for the next records with the same key, so factoring m is not repeated.
 *******************************************************************************/
 
 
+#define _POSIX_C_SOURCE 200112L
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <errno.h>
 #include "lcg.h"
 
+#define CHUNK_MIN 65536
+/*CHUNK_MIN is the fewest bytes of data worth giving a thread of its own.*/
+#define MAX_THREADS 256
+#define WINDOW 4194304
+/*WINDOW is the most bytes of a record each thread converts at a time.*/
+#define BLOCK_SIZE 65536
+/*BLOCK_SIZE is the most bytes read or written at a time.*/
+#define KEY_CACHE 64
+/*KEY_CACHE is the number of recently used keys whose lcg is kept.*/
+
+struct Chunk
+{
+  const char* data;      /* first byte of the chunk */
+  size_t length;         /* bytes in the chunk */
+  unsigned long tokens;  /* characters it stands for, one LCG value each */
+  struct LinearCongruentialGenerator lcg; /* at the chunk's first value */
+  char* out;             /* the converted chunk */
+  size_t out_length;     /* bytes in out */
+  int error;             /* set if the chunk holds an error */
+  pthread_t thread;
+};
+
+struct Key
+{
+  unsigned long m;
+  unsigned long c;
+  struct LinearCongruentialGenerator lcg; /* makeLCG(m, c), not yet used */
+};
+
 
 char e;
-/*char e is simply used to receive standard input using getchar().*/
+/*char e is simply used to receive standard input using next_char().*/
 char operation;
 /*
  * operation is used to denote whether we are encrypting or decrypting.
@@ -61,6 +115,111 @@ char *ptr;
 /*This pointer is used only for the strtoul() function.*/
 struct LinearCongruentialGenerator lcg;
 /*This is the LCG that will be made from the record.*/
+int thread_count = 1;
+/*thread_count is the number of threads converting a record, set by -t.*/
+char* record;
+/*record holds the window of the current record being converted.*/
+size_t record_size;
+/*record_size is the number of bytes allocated for record, one WINDOW per
+thread.*/
+struct Chunk chunks[MAX_THREADS];
+/*chunks[] are the parts of the record converted by each thread.*/
+char in_buffer[BLOCK_SIZE];
+/*in_buffer holds the last block read from the standard input.*/
+size_t in_pos;
+/*in_pos is the place in in_buffer of the next character to be read.*/
+size_t in_length;
+/*in_length is the number of bytes in in_buffer.*/
+char escape[128];
+/*
+ * escape[] gives the character that follows '*' when an encrypted character
+ * would be xor, or 0 if xor is printed as it is. It is filled in by main().
+ */
+char out_buffer[BLOCK_SIZE];
+/*out_buffer holds output that has not been written yet.*/
+size_t out_length;
+/*out_length is the number of bytes in out_buffer.*/
+struct Key key_cache[KEY_CACHE];
+/*key_cache[] holds the keys used most recently, the latest first.*/
+int key_count = 0;
+/*key_count is the number of keys in key_cache[].*/
+
+
+/*******************************************************************************
+ * write_all() writes length bytes of data to the standard output, calling
+ * write() again for whatever an earlier call did not take. It gives up on
+ * the program if the output cannot be written at all.
+*******************************************************************************/
+
+void write_all(const char* data, size_t length)
+{
+  while(length > 0)
+    {
+      ssize_t n = write(STDOUT_FILENO, data, length);
+      if(n < 0)
+        {
+          if(errno == EINTR) continue;
+          perror("cipher");
+          exit(1);
+        }
+      data += n;
+      length -= n;
+    }
+}
+
+/*******************************************************************************
+ * flush_output() writes everything in out_buffer with a single write_all().
+*******************************************************************************/
+
+void flush_output()
+{
+  write_all(out_buffer, out_length);
+  out_length = 0;
+}
+
+/*******************************************************************************
+ * put_text() adds length bytes of text to the output. Text that does not
+ * fit in out_buffer flushes it, and text as long as out_buffer itself is
+ * written straight out instead of being copied.
+*******************************************************************************/
+
+void put_text(const char* text, size_t length)
+{
+  if(out_length + length > BLOCK_SIZE) flush_output();
+  if(length >= BLOCK_SIZE) write_all(text, length);
+  else
+    {
+      memcpy(out_buffer + out_length, text, length);
+      out_length += length;
+    }
+}
+
+/*******************************************************************************
+ * fill_input() flushes the output, then reads the next block of the
+ * standard input into in_buffer. It returns 0 at the end of the input.
+*******************************************************************************/
+
+int fill_input()
+{
+  ssize_t n;
+  flush_output();
+  do n = read(STDIN_FILENO, in_buffer, BLOCK_SIZE);
+  while(n < 0 && errno == EINTR);
+  in_pos = 0;
+  in_length = n > 0 ? n : 0;
+  return in_length > 0;
+}
+
+/*******************************************************************************
+ * next_char() returns the next character of the standard input, or EOF at
+ * the end of it, just as getchar() does.
+*******************************************************************************/
+
+int next_char()
+{
+  if(in_pos == in_length && !fill_input()) return EOF;
+  return (unsigned char)in_buffer[in_pos++];
+}
 
 
 /*******************************************************************************
@@ -79,79 +238,86 @@ struct LinearCongruentialGenerator lcg;
 
 void found_error()
 {
-  printf("Error\n");
+  put_text("Error\n", 6);
   status = 0;
   index1 = 0;
   array[index1] = '\0';
   
-  while(e != '\n' && e != EOF) e = getchar();
+  while(e != '\n' && e != EOF) e = next_char();
 }
 
 /*******************************************************************************
- * convert() is the most important function of the program. It is used only
- * for the part of the record with the data to be converted, and its job is
- * to convert this data, by either decrypting or encrypting as necessary.
+ * convert_token() is the most important function of the program. It is used
+ * only for the part of the record with the data to be converted, and its job
+ * is to convert this data, by either decrypting or encrypting as necessary.
  *
- * convert() does not return anything, but prints the converted character to
- * standard output. convert() takes the parameters e, which is the character
- * to be converted, and the pointer to our lcg, which it uses to encrypt or
- * decrypt e.
+ * convert_token() converts the character at data[*pos], or the '*' pair
+ * starting there when decrypting, moves *pos past it, and puts the result
+ * in out. It returns the number of characters put in out, or -1 if there is
+ * an error. length is the number of bytes in data, so a '*' at the very end
+ * is known to be missing the character that should follow it.
  *
- * convert() makes use of the local variables shift and xor. shift is simply
- * used to store the random value generated by our lcg (mod 128), and xor is
- * the result of the XOR operation between this and e.
+ * convert_token() makes use of shift and the local variable xor. shift is
+ * the next value generated by our lcg (mod 128), and xor is the result of
+ * the XOR operation between this and e.
  *
  * The printable ascii characters are between 32 and 126, inclusive. In the
  * encrypt portion, which starts with the check operation == 'e', we can see
- * how convert() handles situations where xor is not printable. If xor < 32,
- * convert() prints '*' followed by the character found by adding xor to '?'.
- * If xor is 127, which is the largest value it can be since it is mod 128,
- * convert() prints '*' followed by '!'. Other than these special conditions,
- * the encrypt portion of convert() simply prints xor as our encrypted
- * character. Of course, if xor is not a printable character, found_error()
- * is called.
+ * how convert_token() handles situations where xor is not printable. If
+ * xor < 32, it gives '*' followed by the character found by adding xor to
+ * '?'. If xor is 127, which is the largest value it can be since it is mod
+ * 128, it gives '*' followed by '!'. Other than these special conditions,
+ * the encrypt portion simply gives xor as our encrypted character.
  *
- * The decrypt portion of convert() is largely the encrypt portion in reverse,
- * with the possibility of a couple new errors. These errors exist in the 
- * section analagous to the '*'('?' + xor) part of our encryption. An error
- * could be that '*' is followed by an ascii character that is not in an
- * appropriate range, or we could have an xor that is not a printable
+ * The decrypt portion of convert_token() is largely the encrypt portion in
+ * reverse, with the possibility of a couple new errors. These errors exist
+ * in the section analagous to the '*'('?' + xor) part of our encryption. An
+ * error could be that '*' is followed by an ascii character that is not in
+ * an appropriate range, or we could have an xor that is not a printable
  * character. The local variable char d is used as a temporary variable to
  * test for errors in decryption.
 *******************************************************************************/
 
-
-void convert(char e, struct LinearCongruentialGenerator* lcg)
+int convert_token(const char* data, size_t length, size_t* pos,
+                  unsigned long shift, char* out)
 {
-  unsigned long shift = getNextRandomValue(lcg)%128;
+  char e = data[(*pos)++];
   unsigned char xor;
+  if(e < 32 || e > 126) return -1;
+  shift %= 128;
   xor = (e^shift)%128;
   if(operation == 'e')
     {
-      if(xor < 32) printf("%c%c", '*','?' + xor);
-      else if(xor == 127) printf("%c%c", '*','!');
-      else if(xor == '*') printf("%c%c", '*','*');
-      else if(xor > 31 && xor < 127) printf("%c", xor);
-      else found_error();
+      if(xor < 32 || xor == 127 || xor == '*')
+        {
+          out[0] = '*';
+          out[1] = xor < 32 ? '?' + xor : xor == 127 ? '!' : '*';
+          return 2;
+        }
+      out[0] = xor;
+      return 1;
     }
-  else if(operation == 'd')
+  if(e == '*')
     {
-      if(e == '*')
+      if(*pos == length) return -1;
+      e = data[(*pos)++];
+      if(e == '*') out[0] = xor;
+      else if(e == '!') out[0] = (char)(127^shift)%128;
+      else if(e > '?' - 128 && e < '?' + 32)
         {
-          e = getchar();
-          if(e == '*') printf("%c",xor);
-          else if(e == '!') printf("%c", (char)(127^shift)%128);
-          else if(e > '?' - 128 && e < '?' + 32)
-            {
-              char d = ((e - '?')^shift)%128;
-              if(d > 31 && d < 127) printf("%c", d);
-              else found_error();
-            }
-          else found_error();
+          char d = ((e - '?')^shift)%128;
+          if(d > 31 && d < 127) out[0] = d;
+          else return -1;
         }
-      else if(xor > 31 && xor < 127) printf("%c", xor);
-      else found_error();
+      else return -1;
+      return 1;
+    }
+  if(xor > 31 && xor < 127)
+    {
+      out[0] = xor;
+      return 1;
     }
+  return -1;
 }
 
 /*******************************************************************************
@@ -179,6 +345,37 @@ void is_comma()
   status = (status + 1)%4;
 }
 
+/*******************************************************************************
+ * find_lcg() returns the lcg that makeLCG() makes from m and c, calling it
+ * only if the key is not in key_cache[]. Whichever key is used is moved to
+ * the front, so the least recently used key is the one dropped when the
+ * cache is full, and a file using the same key over and over finds it at
+ * the first place it looks. A key that makeLCG() rejects is kept as well,
+ * since it will be rejected again.
+*******************************************************************************/
+
+struct LinearCongruentialGenerator find_lcg(unsigned long m, unsigned long c)
+{
+  struct Key key;
+  int i;
+  for(i = 0; i < key_count; i++)
+    {
+      if(key_cache[i].m == m && key_cache[i].c == c) break;
+    }
+  if(i < key_count) key = key_cache[i];
+  else
+    {
+      key.m = m;
+      key.c = c;
+      key.lcg = makeLCG(m, c);
+      if(key_count < KEY_CACHE) key_count++;
+      i = key_count - 1;
+    }
+  memmove(&key_cache[1], &key_cache[0], i*sizeof(struct Key));
+  key_cache[0] = key;
+  return key.lcg;
+}
+
 /*******************************************************************************
  * read_record() is used to read the record up until the data to be converted
  * is reached. It does not return anything, but affects global variables
@@ -193,11 +390,11 @@ void is_comma()
  * contents of array[] to the appropriate variable.
  *
  * When status 1 and 2 are complete, status 3 is reached and read_record()
- * uses the makeLCG() function defined in lcg.h to make an lcg with m and c
- * and initialize the global variable lcg with this lcg. In the event the
- * values of m or c were not appropriate for any reason, makeLCG() is
- * designed to return an lcg with c = 0. read_record() checks to see if this
- * is the case, and if it is calls found_error().
+ * uses find_lcg(), and through it the makeLCG() function defined in lcg.h,
+ * to get an lcg with m and c and initialize the global variable lcg with
+ * this lcg. In the event the values of m or c were not appropriate for any
+ * reason, makeLCG() is designed to return an lcg with c = 0. read_record()
+ * checks to see if this is the case, and if it is calls found_error().
 *******************************************************************************/
 
 
@@ -205,7 +402,9 @@ void read_record()
 {
   if(status == 0)
     {
-      printf("%5d) ", line_count++);
+      char number[32];
+      sprintf(number, "%5d) ", line_count++);
+      put_text(number, strlen(number));
       if(e == 'e' || e == 'd')
         {
           operation = e;
@@ -221,7 +420,7 @@ void read_record()
           is_comma();
           if(status == 3)
             {
-              lcg = makeLCG(m,c);
+              lcg = find_lcg(m,c);
               if(lcg.c == 0) found_error();
             }
         }
@@ -229,54 +428,361 @@ void read_record()
     }
 }
 
+/*******************************************************************************
+ * read_data() reads more of the current record into record[], after the
+ * length bytes already there, until it holds limit bytes or the record
+ * ends, and returns the number of bytes it then holds. *ended is set if
+ * the newline or EOF that ends the record was reached, and that is left in
+ * e, just as if the data had been read a character at a time. Otherwise e
+ * is left as it was. Each block of input is searched for the newline with
+ * memchr() and copied all at once.
+*******************************************************************************/
+
+size_t read_data(size_t length, size_t limit, int* ended)
+{
+  *ended = 0;
+  while(length < limit)
+    {
+      char* end;
+      size_t n;
+      if(in_pos == in_length && !fill_input())
+        {
+          e = EOF;
+          *ended = 1;
+          return length;
+        }
+      end = memchr(in_buffer + in_pos, '\n', in_length - in_pos);
+      n = (end ? (size_t)(end - in_buffer) : in_length) - in_pos;
+      if(n > limit - length)
+        {
+          n = limit - length;
+          end = NULL;
+        }
+      memcpy(record + length, in_buffer + in_pos, n);
+      length += n;
+      in_pos += n;
+      if(end)
+        {
+          e = in_buffer[in_pos++];
+          *ended = 1;
+          return length;
+        }
+    }
+  return length;
+}
+
+/*******************************************************************************
+ * token_start() returns the first place at or after pos where a character
+ * of the encrypted data begins. Every '*' is the start of a pair, so pos is
+ * the start of a character when the run of '*' just before it has an even
+ * length: those make whole pairs, and the character before them cannot be
+ * the start of one. Otherwise the last '*' of the run goes with data[pos],
+ * and the next character starts after it.
+*******************************************************************************/
+
+size_t token_start(const char* data, size_t length, size_t pos)
+{
+  size_t run = 0;
+  while(run < pos && data[pos - run - 1] == '*') run++;
+  if(run%2 == 1 && pos < length) pos++;
+  return pos;
+}
+
+/*******************************************************************************
+ * count_tokens() is run by a thread for each chunk being decrypted. It
+ * counts the characters the chunk stands for, each '*' pair being one, so
+ * the next chunk knows how far along the LCG sequence it starts.
+*******************************************************************************/
+
+void* count_tokens(void* arg)
+{
+  struct Chunk* chunk = arg;
+  size_t pos = 0;
+  chunk->tokens = 0;
+  while(pos < chunk->length)
+    {
+      pos += chunk->data[pos] == '*' ? 2 : 1;
+      chunk->tokens++;
+    }
+  return NULL;
+}
+
+/*******************************************************************************
+ * encrypt_block() encrypts the length characters of data, the first of
+ * which is at *pos, using one value of keys[] for each, and puts the result
+ * in out. It returns the number of characters put in out, and moves *pos
+ * past the characters encrypted, so if one of them cannot be encrypted
+ * *pos is left there, with out holding the result for the ones before it.
+ *
+ * This is what convert_token() does when encrypting, but without a branch
+ * for each character: escape[] gives the character that goes after the
+ * '*' for each xor that needs one, and 0 for the rest. Every xor is
+ * written to out, along with its escape, and the place in out moves on by
+ * one or two depending on whether there was an escape, so the '*' pairs
+ * are spread out in the same pass. A character that is not printable stops
+ * the loop before it is used.
+*******************************************************************************/
+
+size_t encrypt_block(const char* data, size_t* pos, size_t length,
+                     const unsigned long* keys, char* out)
+{
+  size_t end = *pos + length;
+  size_t out_length = 0;
+  size_t i;
+
+  for(i = *pos; i < end; i++)
+    {
+      unsigned char d = data[i];
+      unsigned char xor = (d^keys[i - *pos])%128;
+      int escaped = escape[xor] != 0;
+      if(d < 32 || d > 126) break;
+      out[out_length] = escaped ? '*' : xor;
+      out[out_length + 1] = escape[xor];
+      out_length += 1 + escaped;
+    }
+  *pos = i;
+  return out_length;
+}
+
+/*******************************************************************************
+ * convert_chunk() is run by a thread for each chunk. It converts the chunk
+ * into chunk->out, stopping at the first error, so out holds exactly what
+ * would have been printed before "Error".
+ *
+ * The keystream is made KEY_BLOCK values at a time with getRandomValues(),
+ * which is much quicker than one value per character. When encrypting,
+ * each block of characters is then encrypted with encrypt_block(). When
+ * decrypting, the '*' pairs make each character a different length, so
+ * the characters are taken one at a time with convert_token(). There can
+ * be no more of them than there are bytes left, so no more values than
+ * that are made. Any left over at the end of the chunk are not needed, and
+ * the first of them is put back in chunk->lcg, which then ends just past
+ * the last value used, ready for whatever comes after the chunk.
+*******************************************************************************/
+
+#define KEY_BLOCK 4096
+
+void* convert_chunk(void* arg)
+{
+  struct Chunk* chunk = arg;
+  unsigned long keys[KEY_BLOCK];
+  size_t pos = 0;
+  chunk->out_length = 0;
+  chunk->error = 0;
+  while(pos < chunk->length && !chunk->error)
+    {
+      size_t count = chunk->length - pos;
+      size_t k;
+      int n;
+      if(count > KEY_BLOCK) count = KEY_BLOCK;
+      getRandomValues(&chunk->lcg, keys, count);
+      if(operation == 'e')
+        {
+          size_t end = pos + count;
+          chunk->out_length += encrypt_block(chunk->data, &pos, count, keys,
+                                             chunk->out + chunk->out_length);
+          if(pos < end) chunk->error = 1;
+          continue;
+        }
+      for(k = 0; k < count && pos < chunk->length; k++)
+        {
+          n = convert_token(chunk->data, chunk->length, &pos, keys[k],
+                            chunk->out + chunk->out_length);
+          if(n < 0)
+            {
+              chunk->error = 1;
+              break;
+            }
+          chunk->out_length += n;
+        }
+      if(k < count && !chunk->error) chunk->lcg.x = keys[k];
+    }
+  return NULL;
+}
+
+/*******************************************************************************
+ * run_chunks() runs work on the first count chunks, one thread each, with
+ * the first done by the calling thread, and returns once all are finished.
+*******************************************************************************/
+
+void run_chunks(void* (*work)(void*), int count)
+{
+  int k;
+  for(k = 1; k < count; k++)
+    {
+      pthread_create(&chunks[k].thread, NULL, work, &chunks[k]);
+    }
+  work(&chunks[0]);
+  for(k = 1; k < count; k++) pthread_join(chunks[k].thread, NULL);
+}
+
+/*******************************************************************************
+ * convert_window() converts the first length bytes of record[] with
+ * thread_count threads, or in the calling thread alone when there is only
+ * one. The data is cut into one chunk per thread, but no chunk smaller
+ * than CHUNK_MIN, and only one chunk if canSkipRandomValues() says lcg
+ * would have to step to each chunk's place. When decrypting, each cut is
+ * moved forward to where a character starts with token_start(), so a '*'
+ * pair is never split between chunks, and if there is more than one
+ * chunk, count_tokens() then works out how many LCG values come before
+ * each. When encrypting, that is just the number of bytes before it.
+ *
+ * Each chunk gets a copy of lcg moved ahead to its first value with
+ * skipRandomValues(), and the chunks are converted at the same time. The
+ * results are printed in order, up to the first chunk with an error, and
+ * lcg is taken from the last chunk, which ends past every value used, ready
+ * for the next window. It returns 1 if there was an error and 0 otherwise.
+*******************************************************************************/
+
+int convert_window(size_t length)
+{
+  size_t start = 0;
+  unsigned long skip = 0;
+  int count = thread_count;
+  int error;
+  int k;
+
+  if(length/CHUNK_MIN < (size_t)count) count = length/CHUNK_MIN;
+  if(count < 1 || !canSkipRandomValues(&lcg)) count = 1;
+  for(k = 0; k < count; k++)
+    {
+      size_t end = k == count - 1 ? length : length/count*(k + 1);
+      if(operation == 'd') end = token_start(record, length, end);
+      if(end < start) end = start;
+      chunks[k].data = record + start;
+      chunks[k].length = end - start;
+      chunks[k].tokens = chunks[k].length;
+      start = end;
+    }
+  if(operation == 'd' && count > 1) run_chunks(count_tokens, count);
+  for(k = 0; k < count; k++)
+    {
+      chunks[k].lcg = lcg;
+      skipRandomValues(&chunks[k].lcg, skip);
+      skip += chunks[k].tokens;
+      chunks[k].out = malloc(chunks[k].length*(operation == 'e' ? 2 : 1) + 1);
+      if(chunks[k].out == NULL)
+        {
+          fprintf(stderr, "cipher: out of memory\n");
+          exit(1);
+        }
+    }
+  run_chunks(convert_chunk, count);
+  lcg = chunks[count - 1].lcg;
+
+  for(k = 0; k < count; k++)
+    {
+      put_text(chunks[k].out, chunks[k].out_length);
+      if(chunks[k].error) break;
+    }
+  error = k < count;
+  for(k = 0; k < count; k++) free(chunks[k].out);
+  return error;
+}
+
+/*******************************************************************************
+ * convert_record() converts the data of a record, once read_record() has
+ * made the lcg. It reads the data with read_data() a window at a time,
+ * record_size bytes at most, or just WINDOW when lcg cannot jump and there
+ * will only be one chunk, and converts each window with convert_window()
+ * before reading the next. When decrypting, a window that ends with the
+ * first '*' of a pair is converted without that '*', which is kept and
+ * goes at the start of the next window.
+ *
+ * An error is followed by "Error" just as found_error() would print it,
+ * and the rest of the record is skipped. Otherwise the record ends with a
+ * newline, unless it ended at EOF.
+*******************************************************************************/
+
+void convert_record()
+{
+  size_t length = 0;
+  size_t limit;
+  int ended = 0;
+
+  if(record == NULL)
+    {
+      record_size = (size_t)thread_count*WINDOW;
+      record = malloc(record_size);
+      if(record == NULL)
+        {
+          fprintf(stderr, "cipher: out of memory\n");
+          exit(1);
+        }
+    }
+  limit = canSkipRandomValues(&lcg) ? record_size : WINDOW;
+  while(!ended)
+    {
+      size_t cut;
+      length = read_data(length, limit, &ended);
+      cut = length;
+      if(operation == 'd' && !ended && record[length - 1] == '*' &&
+         token_start(record, length, length - 1) == length - 1) cut--;
+      if(convert_window(cut))
+        {
+          found_error();
+          return;
+        }
+      length -= cut;
+      memmove(record, record + cut, length);
+    }
+  status = 0;
+  if(e == '\n') put_text("\n", 1);
+}
+
 /*******************************************************************************
  * main() calls functions at appropriate times, depending on the status.
  *
  * main() influences the global variables e and status.
  *
- * It begins by initializing the global variable e using getchar(). The rest
- * of the program takes place inside a while loop because we do not want
- * this program to stop converting records until EOF is encountered. 
+ * It begins by reading the command line, where "-t n" converts each record
+ * with n threads, filling in escape[], and initializing the global variable
+ * e using next_char(). The rest of the program takes place inside a while
+ * loop because we do not want this program to stop converting records until
+ * EOF is encountered.
  *
- * If a '\n' is encountered, it means we have reached the end of a record, so
- * main() resets the status to 0. If e is convertible, main calls convert() to
- * convert it. If e is an unprintable character somehow, found_error() is
- * called. At the end of the while loop, the next character is pulled from
- * standard input using e = getchar();
+ * read_record() is called for each character until the lcg has been made,
+ * when status is 3. The data of the record is then read and converted a
+ * window at a time by convert_record(), which leaves e at the '\n' that
+ * ends the record and sets the status back to 0. At the end of the while
+ * loop, the next character is pulled from standard input using
+ * e = next_char();
 *******************************************************************************/
 
 
-int main(void)
+int main(int argc, char* argv[])
 {
-  e = getchar();
-  while(e != EOF)
+  int arg;
+  for(arg = 1; arg < argc; arg++)
     {
-      if(status != 3) read_record();
-      else
+      if(strcmp(argv[arg], "-t") == 0 && arg + 1 < argc)
         {
-          if(e == '\n')
+          thread_count = atoi(argv[++arg]);
+          if(thread_count < 1 || thread_count > MAX_THREADS)
             {
-              status = 0;
-              printf("\n");
-              
+              fprintf(stderr, "usage: %s [-t threads]\n", argv[0]);
+              return 1;
             }
-          else if(e > 31 && e < 127)
-            {
-              convert(e, &lcg);
-            }
-          else found_error();
         }
-      if(c != EOF) e = getchar();
+      else
+        {
+          fprintf(stderr, "usage: %s [-t threads]\n", argv[0]);
+          return 1;
+        }
     }
-  return 0;
-}
-      
-              
-          
-      
-          
-  
 
-  
+  for(arg = 0; arg < 32; arg++) escape[arg] = '?' + arg;
+  escape[127] = '!';
+  escape['*'] = '*';
 
-  
+  e = next_char();
+  while(e != EOF)
+    {
+      read_record();
+      if(status == 3) convert_record();
+      if(c != EOF) e = next_char();
+    }
+  flush_output();
+  free(record);
+  return 0;
+}
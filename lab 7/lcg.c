@@ -6,109 +6,319 @@
  *
  * lcg.c defines functions used to manipulate Linear Congruential Generators
  * such as makeLCG(), which makes a LCG from the given m and c,
- * uniqueprimes(), which is used to find the unique prime factors of m, and
+ * uniqueprimes(), which is used to find the unique prime factors of m,
  * getNextRandomValue(), which is used to obtain the next x value of the
- * lcg struct.
+ * lcg struct, getRandomValues(), which fills an array with the values that
+ * come next, skipRandomValues(), which moves x ahead by any number of
+ * values at once, and canSkipRandomValues(), which says whether that is
+ * done by jumping or by stepping.
 *******************************************************************************/
 
 
 
 #include "lcg.h"
 #include <stdlib.h>
+#include <limits.h>
+
+#if defined(__SIZEOF_INT128__) && ULONG_MAX == 0xffffffffffffffffUL
+__extension__ typedef unsigned __int128 wide;
+/*
+ * wide holds the full product of two unsigned longs. Where the compiler has
+ * it, the reciprocal replaces the divide in reduce(), the steps put
+ * together by skipRandomValues() can be worked out for any modulus, and
+ * uniqueprimes() multiplies in Montgomery form.
+ */
+#define HAVE_WIDE
+#endif
 
 
 /*******************************************************************************
- * uniqueprimes() is used to find the unique primes of m, called p. It has
- * several local variables: primes_size is the current size of the *primes
- * array. The *primes array is used to store the primes found thus far.
- * primes_found is used as an index of sorts for the *primes array.
- * last_checked is either the last number to be tested to see if it is prime
- * or is the number currently being tested, depending on which part of the
- * function we are in. i is simply used as an index for loops. Of course,
- * p is also a local variable to store the prime factors found so far.
- *
- * uniqueprimes() begins by adding 2 and 3 to *primes as the first two primes.
- * It then checks if m is divisible by either, and if they are, p is
- * multiplied by the appropriate prime. If m = 1 after this step, p is
- * returned.
- *
- * If m is not 1 after this, the program goes about finding primes one by one
- * and testing to see if m is divisible by this newly found prime number.
- * Of course, only odd numbers are tested for primality and they are tested
- * by dividing by every prime already in *prime. If it is prime, it is added
- * to the array. If the *primes array runs out of space, realloc() is used
- * to add 1000 new slots everytime this happens. *temp is used to hold this
- * data first in case there is an error.
- *
- * uniqueprimes() will know to stop either when m is 1, or when the numbers
- * it is testing for primality are as large or larger than the square root
- * of m, in which case what is left of m must be a prime number. It will then
- * multiply p by m and return p.
+ * sieve() fills small_primes[] with the primes below SIEVE_LIMIT, using
+ * the sieve of Eratosthenes, the first time uniqueprimes() is called. Every
+ * m is divided by these first, and what is left over has no factor below
+ * SIEVE_LIMIT, so it is a prime if it is below SIEVE_LIMIT squared and has
+ * at most five prime factors in any case.
 *******************************************************************************/
 
+#define SIEVE_LIMIT 4096
+#define SMALL_PRIMES 564
+/*SMALL_PRIMES is the number of primes below SIEVE_LIMIT.*/
 
-unsigned long uniqueprimes(unsigned long m)
+static unsigned long small_primes[SMALL_PRIMES];
+static int small_count = 0;
+
+static void sieve(void)
 {
-  unsigned long primes_size = 1000;
-  unsigned long primes_found = 2;
-  unsigned long p = 1;
+  static char composite[SIEVE_LIMIT];
   unsigned long i;
-  unsigned long last_checked = 3;
-  unsigned long *primes = malloc(1000*sizeof(unsigned long));
-  primes[0] = 2;
-  primes[1] = 3;
-  for(i=0; i< primes_found; i++)
+  unsigned long j;
+  for(i = 2; i < SIEVE_LIMIT; i++)
+    {
+      if(composite[i]) continue;
+      small_primes[small_count++] = i;
+      for(j = i*i; j < SIEVE_LIMIT; j += i) composite[j] = 1;
+    }
+}
+
+/*******************************************************************************
+ * A Modulus holds an odd n along with what mul_mod() needs to multiply mod
+ * n quickly. With a wide type, numbers are kept in Montgomery form, x*R mod
+ * n with R = 2^64: the product of two of them is reduced by multiplying by
+ * inverse, n's inverse mod 2^64, and keeping the high half, with no divide
+ * at all. Without one, the form is x itself and mul_mod() adds and doubles.
+ * Either way, one is the form of 1, and n - one the form of -1.
+*******************************************************************************/
+
+struct Modulus
+{
+  unsigned long n;
+  unsigned long inverse;
+  unsigned long one;
+};
+
+static struct Modulus make_modulus(unsigned long n)
+{
+  struct Modulus mod;
+  int i;
+  mod.n = n;
+  mod.inverse = n;
+  for(i = 0; i < 5; i++) mod.inverse *= 2 - n*mod.inverse;
+#ifdef HAVE_WIDE
+  mod.one = (ULONG_MAX % n + 1) % n;
+#else
+  mod.one = 1;
+#endif
+  return mod;
+}
+
+static unsigned long to_form(const struct Modulus* mod, unsigned long x)
+{
+#ifdef HAVE_WIDE
+  return (unsigned long)(((wide)x << 64) % mod->n);
+#else
+  return x % mod->n;
+#endif
+}
+
+static unsigned long mul_mod(const struct Modulus* mod, unsigned long a,
+                             unsigned long b)
+{
+#ifdef HAVE_WIDE
+  wide t = (wide)a*b;
+  unsigned long high = (unsigned long)(t >> 64);
+  unsigned long q = (unsigned long)t*mod->inverse;
+  unsigned long qn = (unsigned long)(((wide)q*mod->n) >> 64);
+  return high >= qn ? high - qn : high - qn + mod->n;
+#else
+  unsigned long r = 0;
+  while(b > 0)
+    {
+      if(b & 1) r = r >= mod->n - a ? r - (mod->n - a) : r + a;
+      a = a >= mod->n - a ? a - (mod->n - a) : a + a;
+      b >>= 1;
+    }
+  return r;
+#endif
+}
+
+/*******************************************************************************
+ * is_prime() returns 1 if n, which is odd and has no factor below
+ * SIEVE_LIMIT, is prime. It is the Miller-Rabin test with the first twelve
+ * primes as bases, which no composite below 3*10^24 passes, so for an
+ * unsigned long the answer is certain.
+*******************************************************************************/
+
+static int is_prime(unsigned long n)
+{
+  struct Modulus mod = make_modulus(n);
+  unsigned long minus_one = n - mod.one;
+  unsigned long d = n - 1;
+  int shifts = 0;
+  int i;
+  while(d % 2 == 0)
     {
-      if(m % primes[i] == 0)
+      d /= 2;
+      shifts++;
+    }
+  for(i = 0; i < 12; i++)
+    {
+      unsigned long base = to_form(&mod, small_primes[i]);
+      unsigned long x = mod.one;
+      unsigned long e = d;
+      int k;
+      while(e > 0)
         {
-          p *= primes[i];
-          while(m % primes[i] == 0) m /= primes[i];
+          if(e & 1) x = mul_mod(&mod, x, base);
+          base = mul_mod(&mod, base, base);
+          e >>= 1;
         }
+      if(x == mod.one || x == minus_one) continue;
+      for(k = 1; k < shifts && x != minus_one; k++) x = mul_mod(&mod, x, x);
+      if(x != minus_one) return 0;
+    }
+  return 1;
+}
+
+static unsigned long gcd(unsigned long a, unsigned long b)
+{
+  while(b != 0)
+    {
+      unsigned long t = a % b;
+      a = b;
+      b = t;
     }
-  while(m > 1)
+  return a;
+}
+
+/*******************************************************************************
+ * rho() returns a factor of n, other than 1 and n, when n is odd and not
+ * prime. It is Pollard's rho method as improved by Brent: y walks along
+ * y -> y*y + c mod n, which must come round in a loop mod each prime p of
+ * n after about sqrt(p) steps, and then gcd(x - y, n) picks p out. x is
+ * kept at y's place at the last power of two, so the loop is found without
+ * a second walker, and the differences are multiplied together BATCH at a
+ * time so that a gcd is only taken once a batch. If a batch takes in every
+ * prime at once, it is gone through again from ys one step at a time, and
+ * if that still finds only n, another c is tried. The walk is done in the
+ * form of mul_mod(), which makes no difference to the gcd, since R is odd.
+*******************************************************************************/
+
+#define BATCH 128
+
+static unsigned long rho(unsigned long n)
+{
+  struct Modulus mod = make_modulus(n);
+  unsigned long c;
+  for(c = 1; ; c++)
     {
-      last_checked += 2;
-      while(last_checked != primes[primes_found - 1])
+      unsigned long x = 0;
+      unsigned long y = 2;
+      unsigned long ys = 2;
+      unsigned long q = mod.one;
+      unsigned long d = 1;
+      unsigned long r;
+      unsigned long k;
+      unsigned long i;
+      for(r = 1; d == 1; r *= 2)
         {
-          int factor = 0;
-          for(i = 0; i < primes_found; i++)
+          x = y;
+          for(i = 0; i < r; i++)
             {
-              if(last_checked % primes[i] == 0)
-                {
-                  factor = 1;
-                  break;
-                }
+              y = mul_mod(&mod, y, y);
+              y = y >= n - c ? y - (n - c) : y + c;
             }
-          if(factor == 0)
+          for(k = 0; k < r && d == 1; k += BATCH)
             {
-              primes[primes_found] = last_checked;
-              primes_found++;
-              if(primes_found > primes_size)
+              ys = y;
+              for(i = 0; i < BATCH && i < r - k; i++)
                 {
-                  unsigned long *temp;
-                  primes_size += 1000;
-                  temp = realloc(primes, primes_size*sizeof(unsigned long));
-                  if(temp != NULL) primes = temp;
-                }
-              if(m % last_checked == 0)
-                {
-                  p *= last_checked;
-                  while(m % last_checked == 0) m /= last_checked;
+                  y = mul_mod(&mod, y, y);
+                  y = y >= n - c ? y - (n - c) : y + c;
+                  q = mul_mod(&mod, q, x > y ? x - y : y - x);
                 }
+              d = gcd(q, n);
             }
-          if((last_checked + 2)*(last_checked + 2) > m)
+        }
+      if(d == n)
+        {
+          do
             {
-              p *= m;
-              free(primes);
-              return p;
+              ys = mul_mod(&mod, ys, ys);
+              ys = ys >= n - c ? ys - (n - c) : ys + c;
+              d = gcd(x > ys ? x - ys : ys - x, n);
             }
-          last_checked += 2;
+          while(d == 1);
         }
+      if(d != n) return d;
+    }
+}
+
+/*******************************************************************************
+ * split() adds the prime factors of n, which is more than 1 and has no
+ * factor below SIEVE_LIMIT, to factors[], starting at count, and returns
+ * the new count. A repeated prime is added as many times as it divides n.
+*******************************************************************************/
+
+static int split(unsigned long n, unsigned long* factors, int count)
+{
+  unsigned long d;
+  if(n < (unsigned long)SIEVE_LIMIT*SIEVE_LIMIT || is_prime(n))
+    {
+      factors[count++] = n;
+      return count;
+    }
+  d = rho(n);
+  count = split(d, factors, count);
+  return split(n/d, factors, count);
+}
+
+/*******************************************************************************
+ * uniqueprimes() is used to find the unique primes of m, called p. It
+ * divides m by every prime below SIEVE_LIMIT that goes into it, as often as
+ * it goes, multiplying p by each one, and stops early once the prime
+ * squared is more than what is left of m, which must then be 1 or a prime.
+ *
+ * If what is left is larger than that, it is broken into primes by
+ * split(), with is_prime() and rho(), and each prime is multiplied into p
+ * once however many times it came up. Even for m near 2^64 this takes
+ * microseconds, where dividing by every odd number up to the square root
+ * could take minutes.
+*******************************************************************************/
+
+unsigned long uniqueprimes(unsigned long m)
+{
+  unsigned long factors[8];
+  unsigned long p = 1;
+  int count;
+  int i;
+  int j;
+
+  if(m == 0) return 0;
+  if(small_count == 0) sieve();
+  for(i = 0; i < small_count; i++)
+    {
+      unsigned long prime = small_primes[i];
+      if(prime*prime > m) break;
+      if(m % prime == 0)
+        {
+          p *= prime;
+          while(m % prime == 0) m /= prime;
+        }
+    }
+  if(m == 1) return p;
+  if(i < small_count) return p*m;
+
+  count = split(m, factors, 0);
+  for(i = 0; i < count; i++)
+    {
+      for(j = 0; j < i && factors[j] != factors[i]; j++) continue;
+      if(j == i) p *= factors[i];
     }
-  free(primes);
   return p;
 }
 
+/*******************************************************************************
+ * reduce() returns v mod the lcg's m without a divide, which is by far the
+ * slowest instruction in making a value. When m is a power of two, v mod m
+ * is just the low bits of v. Otherwise q, the high half of v*reciprocal, is
+ * v/m rounded down or at most two less, since reciprocal is ULONG_MAX/m
+ * rounded down, so v - q*m is v mod m after subtracting m at most twice.
+ * Without a wide type, the divide is used after all.
+*******************************************************************************/
+
+static unsigned long reduce(const struct LinearCongruentialGenerator* lcg,
+                            unsigned long v)
+{
+  if(lcg->mask != 0) return v & lcg->mask;
+#ifdef HAVE_WIDE
+  v -= (unsigned long)(((wide)v*lcg->reciprocal) >> 64)*lcg->m;
+  while(v >= lcg->m) v -= lcg->m;
+  return v;
+#else
+  return v % lcg->m;
+#endif
+}
+
 /*******************************************************************************
  * makeLCG() makes an instance of LinearCongruentialGenerator, as the name
  * implies. It does this using m and c. It uses uniqueprimes() to find the
@@ -118,14 +328,15 @@ unsigned long uniqueprimes(unsigned long m)
  * makeLCG() also checks for some errors. m must be greater than 0, c must
  * not be negative, and a must be smaller than m. If any of these rules are
  * broken, makeLCG() will return an lcg with all members equal to 0.
- * Otherwise, it will return an appropriate lcg with initial x equal to c.
+ * Otherwise, it will return an appropriate lcg with initial x equal to c,
+ * along with the mask and reciprocal that reduce() uses in place of % m.
 *******************************************************************************/
 
 struct LinearCongruentialGenerator makeLCG(unsigned long m, unsigned long c)
 {
   unsigned long a;
   unsigned long p;
-  struct LinearCongruentialGenerator lcg = {0, 0, 0, 0};
+  struct LinearCongruentialGenerator lcg = {0, 0, 0, 0, 0, 0};
   if(m <= 0) return lcg;
   if(c < 0) return lcg;
 
@@ -138,6 +349,8 @@ struct LinearCongruentialGenerator makeLCG(unsigned long m, unsigned long c)
       lcg.a = a;
       lcg.c = c;
       lcg.x = c;
+      lcg.mask = (m & (m - 1)) == 0 ? m - 1 : 0;
+      lcg.reciprocal = ULONG_MAX/m;
       return lcg;
     }
 }
@@ -148,13 +361,186 @@ struct LinearCongruentialGenerator makeLCG(unsigned long m, unsigned long c)
  * Since it returns the current value and iterates to the next value of x,
  * a local variable unsigned long x is used to store the current value of x
  * while x is iterated. Then the local variable x is returned.
+ *
+ * a*x + c is worked out in an unsigned long, so it wraps around when m is
+ * large, and only then is it reduced mod m. That is the sequence every
+ * record has been encrypted with, so it is kept as it is.
 *******************************************************************************/
 
 
 unsigned long getNextRandomValue(struct LinearCongruentialGenerator* lcg)
 {
   unsigned long x = lcg->x;
-  lcg->x = ((lcg->a)*(lcg->x)+(lcg->c))%(lcg->m);
+  lcg->x = reduce(lcg, (lcg->a)*(lcg->x)+(lcg->c));
   return x;
 }
 
+/*******************************************************************************
+ * exact() returns 1 if getNextRandomValue() really is the affine map
+ * x -> (a*x + c) mod m for every x below m, so that its steps can be put
+ * together. That holds when a*(m - 1) + c fits in an unsigned long, since
+ * then a*x + c never wraps around, and always when m is a power of two,
+ * since wrapping around only drops bits that the mask drops anyway.
+ * Without a wide type, mul_add() needs narrow() as well.
+ *
+ * narrow() returns 1 if (m - 1)*(m - 1) plus both m - 1 and the lcg's own c
+ * fit in an unsigned long, which holds for m up to 2^32 and small c. Then
+ * the map is exact and any a*x + c with all three below m can be reduced
+ * by reduce() without a wide type.
+*******************************************************************************/
+
+static int narrow(const struct LinearCongruentialGenerator* lcg)
+{
+  unsigned long top = lcg->m - 1;
+  if(lcg->mask != 0) return 1;
+  if(top != 0 && top > ULONG_MAX/top) return 0;
+  return top*top <= ULONG_MAX - (lcg->c > top ? lcg->c : top);
+}
+
+static int exact(const struct LinearCongruentialGenerator* lcg)
+{
+#ifdef HAVE_WIDE
+  if(lcg->mask != 0 || lcg->m < 2) return 1;
+  return lcg->a <= (ULONG_MAX - lcg->c)/(lcg->m - 1);
+#else
+  return narrow(lcg);
+#endif
+}
+
+/*******************************************************************************
+ * mul_add() returns (a*x + c) mod m, for a, x and c below m, when the lcg is
+ * exact(). With a wide type, the product cannot overflow, and otherwise
+ * narrow() says it does not.
+*******************************************************************************/
+
+static unsigned long mul_add(const struct LinearCongruentialGenerator* lcg,
+                             unsigned long a, unsigned long x,
+                             unsigned long c)
+{
+#ifdef HAVE_WIDE
+  if(lcg->mask != 0) return (a*x + c) & lcg->mask;
+  return (unsigned long)(((wide)a*x + c) % lcg->m);
+#else
+  return reduce(lcg, a*x + c);
+#endif
+}
+
+/*******************************************************************************
+ * getRandomValues() fills values[] with the next count values of lcg. Done
+ * one at a time, each value waits for the multiply and the reduction of
+ * the one before it, so most of the time the processor sits idle. Instead
+ * the values are split into LANES interleaved sequences: values[i + LANES]
+ * is found from values[i] by the map (lane_a, lane_c) that takes LANES
+ * steps, so LANES values can be worked out at the same time, and the loop
+ * has no dependence from one value to the next that would stop the
+ * compiler unrolling or vectorizing it. When m is a power of two the loop
+ * is only a multiply, an add and a mask, which vectorizes well.
+ *
+ * That is only right when the lcg is narrow() and the value it starts from
+ * is below m. The first value may be c itself, which can be m or more, so
+ * the first LANES + 1 values, and any count too short to be worth it, are
+ * found with getNextRandomValue() instead.
+*******************************************************************************/
+
+#define LANES 8
+
+void getRandomValues(struct LinearCongruentialGenerator* lcg,
+                     unsigned long* values, size_t count)
+{
+  unsigned long lane_a = 1;
+  unsigned long lane_c = 0;
+  size_t i;
+
+  if(count < 4*LANES || lcg->m == 0 || !narrow(lcg))
+    {
+      for(i = 0; i < count; i++) values[i] = getNextRandomValue(lcg);
+      return;
+    }
+  for(i = 0; i < LANES; i++)
+    {
+      lane_c = mul_add(lcg, lcg->a, lane_c, reduce(lcg, lcg->c));
+      lane_a = mul_add(lcg, lcg->a, lane_a, 0);
+    }
+  for(i = 0; i <= LANES; i++) values[i] = getNextRandomValue(lcg);
+  if(lcg->mask != 0)
+    {
+      for(i = LANES + 1; i < count; i++)
+        {
+          values[i] = (lane_a*values[i - LANES] + lane_c) & lcg->mask;
+        }
+    }
+  else
+    {
+      for(i = LANES + 1; i < count; i++)
+        {
+          values[i] = reduce(lcg, lane_a*values[i - LANES] + lane_c);
+        }
+    }
+  lcg->x = reduce(lcg, lcg->a*values[count - 1] + lcg->c);
+}
+
+
+/*******************************************************************************
+ * skipRandomValues() jumps lcg ahead by steps values. One step is the affine
+ * map x -> (a*x + c) mod m, and doing one affine map after another is again
+ * an affine map, so steps of them can be put together by squaring, the way
+ * a power is worked out: (jump_a, jump_c) is the map for the current power
+ * of two steps, and it is added into (total_a, total_c) for every set bit
+ * of steps. That takes O(log steps) calls of mul_add() instead of steps
+ * calls of getNextRandomValue().
+ *
+ * getNextRandomValue() works in unsigned long, so its a*x + c wraps around
+ * once it gets too big, and the sequence it gives is then no longer the
+ * affine map mod m. Jumping is only right when the map is exact(), which
+ * takes in every m whose a*(m - 1) + c fits; otherwise skipRandomValues()
+ * simply steps steps times. The first value, c itself, may be m or more,
+ * so one step is taken before jumping to bring x below m.
+*******************************************************************************/
+
+void skipRandomValues(struct LinearCongruentialGenerator* lcg,
+                      unsigned long steps)
+{
+  unsigned long top = lcg->m - 1;
+  unsigned long total_a = 1;
+  unsigned long total_c = 0;
+  unsigned long jump_a;
+  unsigned long jump_c;
+
+  if(lcg->m == 0 || steps == 0) return;
+  if(!exact(lcg))
+    {
+      while(steps-- > 0) getNextRandomValue(lcg);
+      return;
+    }
+  if(lcg->x > top)
+    {
+      getNextRandomValue(lcg);
+      steps--;
+    }
+  jump_a = reduce(lcg, lcg->a);
+  jump_c = reduce(lcg, lcg->c);
+  while(steps > 0)
+    {
+      if(steps & 1)
+        {
+          total_a = mul_add(lcg, jump_a, total_a, 0);
+          total_c = mul_add(lcg, jump_a, total_c, jump_c);
+        }
+      jump_c = mul_add(lcg, jump_a, jump_c, jump_c);
+      jump_a = mul_add(lcg, jump_a, jump_a, 0);
+      steps >>= 1;
+    }
+  lcg->x = mul_add(lcg, total_a, lcg->x, total_c);
+}
+
+/*******************************************************************************
+ * canSkipRandomValues() returns 1 if skipRandomValues() jumps lcg ahead by
+ * putting steps together, which it does when the lcg is exact(), and 0 if
+ * it has to step through every value, so a caller can tell whether seeking
+ * far into the sequence is cheap.
+*******************************************************************************/
+
+int canSkipRandomValues(const struct LinearCongruentialGenerator* lcg)
+{
+  return lcg->m != 0 && exact(lcg);
+}
@@ -0,0 +1,233 @@
+/*******************************************************************************
+ * Joseph Adams
+ *
+ * testlcg.c is a program used to test the functions in lcg.c. It prints
+ * each check that fails, and a count of the checks at the end, and exits
+ * with status 1 if any failed.
+ *
+ * uniqueprimes() is checked against products of primes worked out by hand,
+ * from small m to 64-bit primes, squares and semiprimes that only rho() can
+ * break up, makeLCG() against multipliers worked out by hand,
+ * getNextRandomValue() against (a*x + c) % m for values of x all over the
+ * range of an unsigned long, and getRandomValues() and skipRandomValues()
+ * against calling getNextRandomValue() the same number of times, for
+ * moduli small enough to work out several values at once and large enough
+ * that they have to step instead. canSkipRandomValues() is checked against
+ * moduli that can and cannot be jumped.
+*******************************************************************************/
+
+
+#include <stdio.h>
+#include "lcg.h"
+
+
+int checks = 0;
+/*checks is the number of checks made so far.*/
+int failures = 0;
+/*failures is the number of those checks that failed.*/
+
+
+/*******************************************************************************
+ * check_primes() checks that uniqueprimes(m) is p.
+*******************************************************************************/
+
+void check_primes(unsigned long m, unsigned long p)
+{
+  checks++;
+  if(uniqueprimes(m) != p)
+    {
+      printf("uniqueprimes(%lu) = %lu, expected %lu\n", m, uniqueprimes(m),
+             p);
+      failures++;
+    }
+}
+
+/*******************************************************************************
+ * check_make() makes an lcg from m and c and checks that its multiplier is
+ * a, or that it was rejected with every field 0 if a is 0.
+*******************************************************************************/
+
+void check_make(unsigned long m, unsigned long c, unsigned long a)
+{
+  struct LinearCongruentialGenerator lcg = makeLCG(m, c);
+  checks++;
+  if(lcg.a != a || (a == 0 && (lcg.m != 0 || lcg.c != 0 || lcg.x != 0)) ||
+     (a != 0 && (lcg.m != m || lcg.c != c || lcg.x != c)))
+    {
+      printf("makeLCG(%lu, %lu): a = %lu, expected %lu\n", m, c, lcg.a, a);
+      failures++;
+    }
+}
+
+/*******************************************************************************
+ * check_next() sets lcg to x and checks that getNextRandomValue() gives x
+ * and moves on to (a*x + c) % m, worked out with the divide it replaces.
+*******************************************************************************/
+
+void check_next(struct LinearCongruentialGenerator lcg, unsigned long x)
+{
+  unsigned long expected = (lcg.a*x + lcg.c) % lcg.m;
+  lcg.x = x;
+  checks++;
+  if(getNextRandomValue(&lcg) != x || lcg.x != expected)
+    {
+      printf("getNextRandomValue(m = %lu, c = %lu) from %lu: %lu, "
+             "expected %lu\n", lcg.m, lcg.c, x, lcg.x, expected);
+      failures++;
+    }
+}
+
+/*******************************************************************************
+ * check_can_skip() makes an lcg from m and c and checks that
+ * canSkipRandomValues() is expected.
+*******************************************************************************/
+
+void check_can_skip(unsigned long m, unsigned long c, int expected)
+{
+  struct LinearCongruentialGenerator lcg = makeLCG(m, c);
+  checks++;
+  if(canSkipRandomValues(&lcg) != expected)
+    {
+      printf("canSkipRandomValues(m = %lu, c = %lu) = %d, expected %d\n", m,
+             c, canSkipRandomValues(&lcg), expected);
+      failures++;
+    }
+}
+
+/*******************************************************************************
+ * check_skip() makes two copies of lcg, moves both ahead by first values
+ * with getNextRandomValue() to start somewhere other than the seed, then
+ * moves one by steps values one at a time and jumps the other with
+ * skipRandomValues(), and checks that they agree.
+*******************************************************************************/
+
+void check_skip(struct LinearCongruentialGenerator lcg, unsigned long first,
+                unsigned long steps)
+{
+  struct LinearCongruentialGenerator stepped = lcg;
+  struct LinearCongruentialGenerator jumped;
+  unsigned long i;
+  for(i = 0; i < first; i++) getNextRandomValue(&stepped);
+  jumped = stepped;
+  for(i = 0; i < steps; i++) getNextRandomValue(&stepped);
+  skipRandomValues(&jumped, steps);
+  checks++;
+  if(jumped.x != stepped.x)
+    {
+      printf("skipRandomValues(m = %lu, c = %lu) from %lu by %lu: "
+             "x = %lu, expected %lu\n", lcg.m, lcg.c, first, steps, jumped.x,
+             stepped.x);
+      failures++;
+    }
+}
+
+/*******************************************************************************
+ * check_values() gets count values of lcg with getRandomValues(), starting
+ * after first values, and checks each of them, and the value after them,
+ * against getNextRandomValue().
+*******************************************************************************/
+
+void check_values(struct LinearCongruentialGenerator lcg, unsigned long first,
+                  size_t count)
+{
+  static unsigned long values[1000];
+  struct LinearCongruentialGenerator stepped = lcg;
+  unsigned long i;
+  for(i = 0; i < first; i++) getNextRandomValue(&stepped);
+  lcg = stepped;
+  getRandomValues(&lcg, values, count);
+  checks++;
+  for(i = 0; i <= count; i++)
+    {
+      unsigned long value = i < count ? values[i] : getNextRandomValue(&lcg);
+      unsigned long expected = getNextRandomValue(&stepped);
+      if(value != expected)
+        {
+          printf("getRandomValues(m = %lu, c = %lu) from %lu, value %lu of "
+                 "%lu: %lu, expected %lu\n", lcg.m, lcg.c, first, i,
+                 (unsigned long)count, value, expected);
+          failures++;
+          break;
+        }
+    }
+}
+
+/*******************************************************************************
+ * main() runs every check. The moduli include ones divisible by 4, primes,
+ * a c larger than m, powers of two, m large enough that only a wide type
+ * can jump, and the m of novel.crypt, whose values wrap around and can
+ * only be stepped.
+*******************************************************************************/
+
+int main(void)
+{
+  unsigned long moduli[] = {2, 9, 16, 100, 999, 1024, 65537, 4294967291UL,
+                            4294967296UL, 1099511627776UL, 3298534883328UL,
+                            1000000000000000000UL, 16617738773379225311UL};
+  unsigned long xs[] = {0, 1, 2, 12345, 4294967295UL, 4294967296UL,
+                        999999999999999999UL, 9223372036854775807UL,
+                        9223372036854775808UL, 18446744073709551615UL};
+  unsigned long increments[] = {1, 7, 12345, 4000000000UL};
+  unsigned long steps[] = {0, 1, 2, 3, 10, 255, 1000, 65536, 1234567};
+  int i;
+  int j;
+  int k;
+
+  check_primes(1, 1);
+  check_primes(2, 2);
+  check_primes(360, 30);
+  check_primes(4096, 2);
+  check_primes(4093UL*4093UL, 4093);
+  check_primes(4099UL*4099UL, 4099);
+  check_primes(999999000001UL, 999999000001UL);
+  check_primes(1000000000000000000UL, 10);
+  check_primes(16617738773379225311UL, 6258474671UL);
+  check_primes(18446744073709551557UL, 18446744073709551557UL);
+  check_primes(4294967291UL*4294967279UL, 4294967291UL*4294967279UL);
+  check_primes(4294967291UL*4294967291UL, 4294967291UL);
+  check_primes(2642239UL*2642239UL*2642239UL, 2642239UL);
+  check_primes(4099UL*4111UL*4127UL*4129UL*4133UL,
+               4099UL*4111UL*4127UL*4129UL*4133UL);
+  check_primes(12UL*4294967291UL*65537UL, 6UL*4294967291UL*65537UL);
+
+  check_make(10, 1, 0);
+  check_make(100, 3, 21);
+  check_make(81, 2, 4);
+  check_make(1024, 1, 5);
+  check_make(3, 1, 0);
+  check_make(0, 1, 0);
+
+  check_can_skip(100, 3, 1);
+  check_can_skip(1024, 1, 1);
+  check_can_skip(3298534883328UL, 7, 1);
+  check_can_skip(16617738773379225311UL, 1, 0);
+  check_can_skip(10, 1, 0);
+
+  for(i = 0; i < (int)(sizeof(moduli)/sizeof(moduli[0])); i++)
+    {
+      for(j = 0; j < (int)(sizeof(increments)/sizeof(increments[0])); j++)
+        {
+          struct LinearCongruentialGenerator lcg =
+            makeLCG(moduli[i], increments[j]);
+          if(lcg.m == 0) continue;
+          for(k = 0; k < (int)(sizeof(xs)/sizeof(xs[0])); k++)
+            {
+              check_next(lcg, xs[k]);
+              check_next(lcg, xs[k] % lcg.m);
+              check_next(lcg, lcg.m - 1 - xs[k] % lcg.m);
+            }
+          for(k = 0; k < (int)(sizeof(steps)/sizeof(steps[0])); k++)
+            {
+              check_skip(lcg, 0, steps[k]);
+              check_skip(lcg, 5, steps[k]);
+            }
+          check_values(lcg, 0, 1);
+          check_values(lcg, 0, 1000);
+          check_values(lcg, 3, 33);
+          check_values(lcg, 5, 999);
+        }
+    }
+
+  printf("%d checks, %d failed\n", checks, failures);
+  return failures == 0 ? 0 : 1;
+}